@@ -0,0 +1,10 @@
+for run in `seq 1 10000`;
+do 
+    for t in cuckoofilter bloom;
+    do
+        for h in `seq 0 11`;
+        do
+            ../build/src/hashingtest -t $t $(od -A n -t u -N 4 /dev/urandom) $h $((2**22)) | tee -a $HOSTNAME-filters.txt
+        done;
+    done;
+done;
@@ -0,0 +1,7 @@
+for t in cuckoo linear swiss;
+do
+    for h in `seq 0 11`;
+    do
+        ../build/src/hashingtest -t $t -L -r 100 -a 0.01 $(od -A n -t u -N 4 /dev/urandom) $h $((2**22)) | tee -a $HOSTNAME-repeated.txt
+    done;
+done;
@@ -0,0 +1,10 @@
+for run in `seq 1 100`;
+do 
+    for p in 1 2 4 8 16 32;
+    do
+        for h in `seq 0 11`;
+        do
+            ../build/src/hashingtest -t sharded -p $p $(od -A n -t u -N 4 /dev/urandom) $h $((2**24)) | tee -a $HOSTNAME-sharded.txt
+        done;
+    done;
+done;
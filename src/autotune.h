@@ -0,0 +1,338 @@
+#ifndef AUTOTUNE_H
+#define AUTOTUNE_H
+
+#include <stdint.h>
+#include <vector>
+#include <string>
+#include <fstream>
+#include <iostream>
+#include <algorithm>
+
+#include "hashfunctions.h"
+#include "methods.h"
+#include "cuckoohashing.h"
+#include "tools/timer.h"
+
+// keys of the sample every candidate is measured on
+#ifndef AUTOTUNE_SAMPLE
+#define AUTOTUNE_SAMPLE (1 << 16)
+#endif
+
+// candidates whose bucket loads have a larger dispersion index are rejected
+#ifndef AUTOTUNE_MAX_SKEW
+#define AUTOTUNE_MAX_SKEW 1.5
+#endif
+
+// slot modes that stash a larger share of the keys at full load are
+// rejected
+#ifndef AUTOTUNE_MAX_STASH_SHARE
+#define AUTOTUNE_MAX_STASH_SHARE 1e-4
+#endif
+
+// timed runs per candidate, the fastest counts
+#ifndef AUTOTUNE_ROUNDS
+#define AUTOTUNE_ROUNDS 2
+#endif
+
+// Choice of hash function and slot layout of the cuckoo table for the key
+// set and the machine at hand. Every method is checked for skew on a
+// sample of the keys, and in each slot mode for the stash of a table that
+// holds the sample at the load of the final table. The remaining ones are
+// timed inserting the sample into a table of the final size and looking it
+// up again, with the batch lookup as well for two functions. Weaknesses of
+// a hash function may only show with all keys, so the fastest candidates
+// are then built with all keys in turn until one keeps its stash small.
+// Choices can be kept in a file, one line
+//   autotune <version> <n> <method> <single> <batch>
+// and are reused for the same n.
+namespace autotune {
+
+    static const int FILE_VERSION = 1;
+
+    struct Candidate
+    {
+        int method;
+        // cuckoohashing::single_mode_t
+        int single;
+        bool batch_lookup;
+        std::string name;
+        double skew;
+        // stash at full load, of the sample or of all keys if validated
+        size_t stash;
+        bool validated;
+        // nanoseconds per key of the sample
+        double insert_ns, lookup_ns;
+        bool rejected;
+    };
+
+    // index of dispersion (variance / mean) of the loads of count / 8
+    // buckets under h1 and h2, the larger of both; about 1 for random
+    // hash values
+    double skew(HashFunction* h, const uint32_t* keys, size_t count)
+    {
+        const uint32_t buckets = std::max((size_t) 1, count / 8);
+        const double mean = (double) count / buckets;
+        double res = 0;
+        for (int f = 0; f < 2; f++)
+        {
+            std::vector<uint32_t> load(buckets, 0);
+            for (size_t i = 0; i < count; i++)
+            {
+                load[(f ? h->h2(keys[i]) : h->h1(keys[i])) % buckets]++;
+            }
+            double var = 0;
+            for (uint32_t b = 0; b < buckets; b++)
+            {
+                var += (load[b] - mean) * (load[b] - mean);
+            }
+            res = std::max(res, var / buckets / mean);
+        }
+        return res;
+    }
+
+    template <void (*insert)(uint32_t)>
+    void insert_range(const uint32_t* keys, size_t count)
+    {
+        for (size_t i = 0; i < count; i++)
+        {
+            insert(keys[i]);
+        }
+    }
+
+    template <bool (*lookup)(uint32_t)>
+    uint64_t lookup_range(const uint32_t* keys, size_t count)
+    {
+        uint64_t res = 0;
+        for (size_t i = 0; i < count; i++)
+        {
+            res += lookup(keys[i]);
+        }
+        return res;
+    }
+
+    inline void insert_two(uint32_t key)
+    {
+        cuckoohashing::insert(key);
+    }
+
+    // insert keys into cuckoohashing in slot mode single
+    void insert_mode(int single, const uint32_t* keys, size_t count)
+    {
+        switch (single)
+        {
+            case cuckoohashing::TWO_FUNCTIONS:
+                insert_range<insert_two>(keys, count);
+                break;
+            case cuckoohashing::SPLIT:
+                insert_range<cuckoohashing::insert_single<cuckoohashing::SPLIT> >(keys, count);
+                break;
+            case cuckoohashing::FINGERPRINT:
+                insert_range<cuckoohashing::insert_single<cuckoohashing::FINGERPRINT> >(keys, count);
+                break;
+        }
+    }
+
+    // look up keys in cuckoohashing in slot mode single, returns the hits
+    uint64_t lookup_mode(int single, bool batch_lookup, const uint32_t* keys, size_t count)
+    {
+        switch (single)
+        {
+            case cuckoohashing::SPLIT:
+                return lookup_range<cuckoohashing::lookup_single<cuckoohashing::SPLIT> >(keys, count);
+            case cuckoohashing::FINGERPRINT:
+                return lookup_range<cuckoohashing::lookup_single<cuckoohashing::FINGERPRINT> >(keys, count);
+        }
+        if (!batch_lookup)
+            return lookup_range<cuckoohashing::lookup>(keys, count);
+
+        std::vector<uint64_t> found((count + 63) / 64);
+        cuckoohashing::lookup_many(keys, count, found.data());
+        uint64_t res = 0;
+        for (size_t i = 0; i < found.size(); i++)
+        {
+            res += __builtin_popcountll(found[i]);
+        }
+        return res;
+    }
+
+    // stash left by inserting keys into a table with 1.005 slots per key
+    size_t full_load_stash(HashFunction* h, int single, const uint32_t* keys, size_t count)
+    {
+        cuckoohashing::init(1.005 * count, h);
+        insert_mode(single, keys, count);
+        size_t res = cuckoohashing::stash.size();
+        cuckoohashing::destroy();
+        return res;
+    }
+
+    // fastest of AUTOTUNE_ROUNDS runs inserting keys into an empty table
+    // with m slots and looking them up again
+    void time_candidate(HashFunction* h, Candidate& c, const uint32_t* keys, size_t count, uint32_t m)
+    {
+        for (int r = 0; r < AUTOTUNE_ROUNDS; r++)
+        {
+            cuckoohashing::init(m, h);
+            ClockIntervalBase<CLOCK_MONOTONIC> timer;
+            timer.start();
+            insert_mode(c.single, keys, count);
+            timer.stop();
+            double insert_ns = timer.delta() * 1e9 / count;
+
+            timer.start();
+            escape(lookup_mode(c.single, c.batch_lookup, keys, count));
+            timer.stop();
+            double lookup_ns = timer.delta() * 1e9 / count;
+            cuckoohashing::destroy();
+
+            if (r == 0 || insert_ns < c.insert_ns)
+                c.insert_ns = insert_ns;
+            if (r == 0 || lookup_ns < c.lookup_ns)
+                c.lookup_ns = lookup_ns;
+        }
+    }
+
+    inline bool faster(const Candidate& a, const Candidate& b)
+    {
+        return a.insert_ns + a.lookup_ns < b.insert_ns + b.lookup_ns;
+    }
+
+    // Measure all candidates for the cuckoo table with m slots per table
+    // holding keys. Every hash function is drawn from the state g_gen has
+    // on entry, which is restored at the end, so a candidate is the same
+    // function a trial with the same seed draws afterwards.
+    std::vector<Candidate> run(const std::vector<uint32_t>& keys, uint32_t m)
+    {
+        const uint32_t n = keys.size();
+        const size_t count = std::min((size_t) AUTOTUNE_SAMPLE, keys.size());
+        const uint32_t* sample = keys.data();
+
+        boost::mt19937_64 saved = g_gen;
+        std::vector<Candidate> res;
+
+        for (int method = 0; method < NUM_METHODS; method++)
+        {
+            // fully random hash values are no function of the key
+            if (method == 12)
+                continue;
+
+            g_gen = saved;
+            HashFunction* h = create_hash_function(method, n);
+
+            Candidate c;
+            c.method = method;
+            c.single = cuckoohashing::TWO_FUNCTIONS;
+            c.batch_lookup = false;
+            c.name = h->getDescription();
+            c.skew = skew(h, sample, count);
+            c.stash = 0;
+            c.validated = false;
+            c.insert_ns = c.lookup_ns = 0;
+            c.rejected = c.skew > AUTOTUNE_MAX_SKEW;
+
+            if (c.rejected)
+            {
+                res.push_back(c);
+                delete h;
+                continue;
+            }
+
+            for (int single = cuckoohashing::TWO_FUNCTIONS; single <= cuckoohashing::FINGERPRINT; single++)
+            {
+                c.single = single;
+                c.stash = full_load_stash(h, single, sample, count);
+                c.rejected = c.stash > AUTOTUNE_MAX_STASH_SHARE * count;
+                for (int batch = 0; batch <= (single == cuckoohashing::TWO_FUNCTIONS); batch++)
+                {
+                    c.batch_lookup = batch;
+                    c.insert_ns = c.lookup_ns = 0;
+                    if (!c.rejected)
+                        time_candidate(h, c, sample, count, m);
+                    res.push_back(c);
+                }
+            }
+            delete h;
+        }
+
+        // build the fastest candidates with all keys until one passes
+        while (true)
+        {
+            Candidate* next = NULL;
+            for (size_t i = 0; i < res.size(); i++)
+            {
+                if (!res[i].rejected && !res[i].validated && (next == NULL || faster(res[i], *next)))
+                    next = &res[i];
+            }
+            if (next == NULL)
+                break;
+
+            g_gen = saved;
+            HashFunction* h = create_hash_function(next->method, n);
+            next->stash = full_load_stash(h, next->single, keys.data(), n);
+            next->validated = true;
+            next->rejected = next->stash > AUTOTUNE_MAX_STASH_SHARE * n;
+            delete h;
+
+            // the other lookup of the same build passes or fails alike
+            for (size_t i = 0; i < res.size(); i++)
+            {
+                if (res[i].method == next->method && res[i].single == next->single)
+                {
+                    res[i].stash = next->stash;
+                    res[i].validated = true;
+                    res[i].rejected = next->rejected;
+                }
+            }
+            if (!next->rejected)
+                break;
+        }
+
+        g_gen = saved;
+        return res;
+    }
+
+    // the fastest validated candidate, false if there is none
+    bool best(const std::vector<Candidate>& candidates, Candidate& res)
+    {
+        bool found = false;
+        for (size_t i = 0; i < candidates.size(); i++)
+        {
+            const Candidate& c = candidates[i];
+            if (c.rejected || !c.validated)
+                continue;
+            if (!found || faster(c, res))
+            {
+                res = c;
+                found = true;
+            }
+        }
+        return found;
+    }
+
+    // read the choice for n keys from path, false if there is none
+    bool load(const std::string& path, uint32_t n, Candidate& res)
+    {
+        std::ifstream is(path.c_str());
+        std::string magic;
+        int version = 0;
+        uint32_t file_n = 0;
+        is >> magic >> version >> file_n >> res.method >> res.single >> res.batch_lookup;
+        return is && magic == "autotune" && version == FILE_VERSION && file_n == n &&
+            res.method >= 0 && res.method < NUM_METHODS &&
+            res.single >= cuckoohashing::TWO_FUNCTIONS && res.single <= cuckoohashing::FINGERPRINT;
+    }
+
+    bool save(const std::string& path, uint32_t n, const Candidate& c)
+    {
+        std::ofstream os(path.c_str());
+        os << "autotune " << FILE_VERSION << " " << n << " " << c.method << " "
+           << c.single << " " << c.batch_lookup << "\n";
+        if (!os)
+        {
+            std::cerr << "autotune: cannot write " << path << std::endl;
+            return false;
+        }
+        return true;
+    }
+}
+
+#endif // AUTOTUNE_H
@@ -0,0 +1,114 @@
+#ifndef BINS_H
+#define BINS_H
+
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+
+#include "hashfunctions.h"
+#include "random.h"
+
+// Balanced allocation: ball i with key gen(i) goes to the least loaded of d
+// bins chosen by the hash function, the first of them on ties. The bins
+// are split into 2^shard_bits shards of consecutive bins, and ball i
+// belongs to shard i mod 2^shard_bits, so every shard gets the same number
+// of balls (up to one) and no bits of the hash go into the shard. The d
+// choices lie in the shard of the ball, as
+//   choice 0: h1, choice j > 0: h2 + (j - 1) * h1,
+// each mapped to the bins of the shard by multiply-shift. Every shard
+// places its balls in order of their index on one thread, so the result
+// does not depend on the number of threads; with shard_bits 0 it is the
+// sequential greedy process over all bins.
+namespace bins {
+
+    enum generator_t { DENSE, CUBE, RANDOM, NUM_GENERATORS };
+
+    // key of ball i: i + 1, i as 4 digits of base b in the 4 bytes (the
+    // hypercube [b]^4 of the cuckoo experiments), or a random word
+    inline uint32_t key(int gen, uint64_t i, uint32_t b, uint64_t seed)
+    {
+        switch (gen)
+        {
+            case DENSE:
+                return i + 1;
+            case CUBE:
+                return ((i / b / b / b % b) << 24) | ((i / b / b % b) << 16) |
+                       ((i / b % b) << 8) | (i % b);
+            default:
+                return ctrrng::at(seed, 0, i);
+        }
+    }
+
+    // smallest base whose hypercube holds count keys, at most 256
+    uint32_t cube_base(uint64_t count)
+    {
+        uint32_t b = 1;
+        while (b < 256 && (uint64_t) b * b * b * b < count)
+            b++;
+        return b;
+    }
+
+    inline uint32_t reduce(uint32_t x, uint32_t range)
+    {
+        return ((uint64_t) x * range) >> 32;
+    }
+
+    std::vector<uint32_t> load;
+
+    uint32_t shard_bits;
+
+    HashFunction* h;
+
+    // first bin of shard s of 2^shard_bits
+    inline uint64_t shard_begin(uint32_t s)
+    {
+        return (load.size() * s) >> shard_bits;
+    }
+
+    // throw balls with keys gen(0), ..., gen(balls - 1) into nbins bins
+    void run(HashFunction* _h, uint64_t nbins, uint64_t balls, uint32_t d, int gen, uint32_t _shard_bits,
+             uint64_t seed)
+    {
+        h = _h;
+        shard_bits = _shard_bits;
+        load.assign(nbins, 0);
+
+        const uint32_t nshards = 1 << shard_bits;
+        const uint32_t b = cube_base(balls);
+
+#pragma omp parallel for schedule(dynamic)
+        for (uint32_t s = 0; s < nshards; s++)
+        {
+            uint32_t* bins = &load[shard_begin(s)];
+            const uint32_t range = shard_begin(s + 1) - shard_begin(s);
+            for (uint64_t i = s; i < balls; i += nshards)
+            {
+                const uint32_t x = key(gen, i, b, seed);
+                const uint32_t g1 = h->h1(x), g2 = h->h2(x);
+                uint32_t best = reduce(g1, range);
+                uint32_t y = g2;
+                for (uint32_t j = 1; j < d; j++, y += g1)
+                {
+                    uint32_t c = reduce(y, range);
+                    if (bins[c] < bins[best])
+                        best = c;
+                }
+                bins[best]++;
+            }
+        }
+    }
+
+    // hist[i]: number of bins with load min_load + i
+    void histogram(uint32_t& min_load, std::vector<uint64_t>& hist)
+    {
+        min_load = *std::min_element(load.begin(), load.end());
+        uint32_t max_load = *std::max_element(load.begin(), load.end());
+        hist.assign(max_load - min_load + 1, 0);
+        for (size_t i = 0; i < load.size(); i++)
+        {
+            hist[load[i] - min_load]++;
+        }
+    }
+}
+
+#endif // BINS_H
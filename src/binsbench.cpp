@@ -0,0 +1,135 @@
+#include<vector>
+#include<cmath>
+#include<string>
+#include <unistd.h>
+#include <boost/random.hpp>
+
+static boost::mt19937_64 g_gen;
+
+#include "hashfunctions.h"
+#include "tools/timer.h"
+#include "methods.h"
+#include "bins.h"
+
+// Balls into bins with the power of d choices over the hash functions and
+// key generators of bins.h: the max load, the gap to the average load and
+// the histogram of the loads per method, next to the throughput.
+
+static const char* generator_names[] = { "dense", "cube", "random" };
+
+void bench(int method, int gen, uint32_t seed, uint64_t nbins, uint64_t balls, uint32_t d,
+           uint32_t shard_bits)
+{
+    g_gen.seed(seed);
+    HashFunction* h = create_hash_function(method, std::min(balls, (uint64_t) UINT32_MAX));
+
+    ClockIntervalBase<CLOCK_MONOTONIC> timer;
+    timer.start();
+    bins::run(h, nbins, balls, d, gen, shard_bits, seed);
+    timer.stop();
+
+    uint32_t min_load;
+    std::vector<uint64_t> hist;
+    bins::histogram(min_load, hist);
+    const uint32_t max_load = min_load + hist.size() - 1;
+    const double avg = (double) balls / nbins;
+
+    std::cout <<
+        " bins=" << nbins <<
+        " balls=" << balls <<
+        " seed=" << seed <<
+        " h=" << method <<
+        " name=" << h->getDescription() <<
+        " keys=" << generator_names[gen] <<
+        " d=" << d <<
+        " shards=" << (1 << shard_bits) <<
+        " threads=" << omp_get_max_threads() <<
+        " time=" << timer.delta() <<
+        " balls_per_s=" << balls / timer.delta() <<
+        " avg_load=" << avg <<
+        " min_load=" << min_load <<
+        " max_load=" << max_load <<
+        " gap=" << max_load - avg <<
+        " load_hist=";
+    for (size_t i = 0; i < hist.size(); i++)
+    {
+        std::cout << (i ? "/" : "") << hist[i];
+    }
+    std::cout << std::endl;
+
+    delete h;
+}
+
+int main(int argc, char** argv)
+{
+    int only_method = -1;
+    int only_gen = -1;
+    uint32_t d = 2;
+    uint32_t shard_bits = 8;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "m:g:d:s:p:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'm':
+                only_method = atoi(optarg);
+                break;
+            case 'g':
+                for (only_gen = 0; only_gen < bins::NUM_GENERATORS; only_gen++)
+                    if (generator_names[only_gen] == std::string(optarg))
+                        break;
+                break;
+            case 'd':
+                d = atoi(optarg);
+                break;
+            case 's':
+                shard_bits = std::max(0, std::min(16, atoi(optarg)));
+                break;
+            case 'p':
+                omp_set_num_threads(atoi(optarg));
+                break;
+            default:
+                return 0;
+        }
+    }
+    argv += optind - 1;
+    argc -= optind - 1;
+
+    uint64_t nbins = (argc >= 3) ? strtoull(argv[2], NULL, 10) : (1 << 20);
+    uint64_t balls = (argc == 4) ? strtoull(argv[3], NULL, 10) : nbins;
+
+    if (argc < 2 || argc > 4 || only_gen == bins::NUM_GENERATORS || d < 1 ||
+        nbins < (1ULL << shard_bits) || (nbins >> shard_bits) >= (1ULL << 32) || balls < 1)
+    {
+        std::cout << "Usage: [-m method] [-g keys] [-d choices] [-s shard_bits] [-p threads] seed [bins] [balls]" << std::endl;
+        std::cout << "Throws balls (default: bins) into bins (default 2^20), each into the least\n"
+                  << "loaded of d bins (default 2) from h1 and h2. The bins are split into\n"
+                  << "2^shard_bits shards (default 2^8) that take every 2^shard_bits-th ball\n"
+                  << "with all its choices and are filled on -p threads; -s 0 is the sequential\n"
+                  << "process. Keys of the balls: dense 1, 2, ..., cube the hypercube [b]^4\n"
+                  << "and random words, -g selects one.\n"
+                  << "Method 12 is skipped, its values come from one generator shared by the\n"
+                  << "threads." << std::endl;
+        std::cout << "Available Methods: \n";
+        print_methods(std::cout);
+        return 0;
+    }
+
+    uint32_t seed = atoi(argv[1]);
+
+    for (int method = 0; method < NUM_METHODS; method++)
+    {
+        if (method == 12 || (only_method >= 0 && method != only_method))
+            continue;
+
+        for (int gen = 0; gen < bins::NUM_GENERATORS; gen++)
+        {
+            if (only_gen >= 0 && gen != only_gen)
+                continue;
+            bench(method, gen, seed, nbins, balls, d, shard_bits);
+        }
+    }
+
+    return 0;
+}
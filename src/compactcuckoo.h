@@ -0,0 +1,198 @@
+#ifndef COMPACTCUCKOO_H
+#define COMPACTCUCKOO_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <iostream>
+
+#include "hashfunctions.h"
+
+#ifndef MAXLOOP
+#define MAXLOOP 1000
+#endif
+
+// rounds of the Feistel permutations
+#ifndef FEISTEL_ROUNDS
+#define FEISTEL_ROUNDS 3
+#endif
+
+// Cuckoo hashing with quotienting. Table t in {0, 1} maps a key x through
+// a Feistel permutation y = P_t(x) of the 32-bit keys, whose round
+// functions are h1 (t = 0) or h2 (t = 1) of the hash function. The key
+// goes to slot y % m and only y / m + 1 is stored, which together with the
+// slot gives back y and with the inverse permutation x; 0 marks an empty
+// slot. Slots are packed into the bits needed for 2^32 / m + 1, so at
+// 2^24 keys a slot takes 8 instead of 32 bits. A slot is read with one
+// unaligned 64-bit load, a shift and a mask, the same for every slot and
+// without branches. Keys that find no place go to a stash of full keys.
+namespace compactcuckoo {
+
+    uint8_t* t[2];
+
+    uint32_t m;
+    uint32_t slot_bits;
+    uint64_t slot_mask;
+
+    HashFunction* h;
+    std::vector<uint32_t> stash;
+
+    // bytes of a table of m slots, padded for the 64-bit load of the last
+    inline size_t table_bytes()
+    {
+        return ((uint64_t) m * slot_bits + 7) / 8 + 8;
+    }
+
+    void init(uint32_t _m, HashFunction* _h)
+    {
+        h = _h;
+        m = std::max(_m, (uint32_t) 2);
+        stash.clear();
+
+        uint64_t max_value = ((1ULL << 32) - 1) / m + 1;
+        slot_bits = 1;
+        while ((max_value >> slot_bits) != 0)
+            slot_bits++;
+        slot_mask = (1ULL << slot_bits) - 1;
+
+        for (int i = 0; i < 2; i++)
+        {
+            t[i] = (uint8_t*) calloc(table_bytes(), 1);
+            if (t[i] == NULL)
+            {
+                std::cerr << "compactcuckoo: cannot allocate " << m << " slots" << std::endl;
+                abort();
+            }
+        }
+    }
+
+    void destroy()
+    {
+        free(t[0]);
+        free(t[1]);
+    }
+
+    void memory_regions(std::vector<MemoryRegion>& regions)
+    {
+        regions.push_back(MemoryRegion{ t[0], table_bytes() });
+        regions.push_back(MemoryRegion{ t[1], table_bytes() });
+        regions.push_back(MemoryRegion{ stash.data(), stash.capacity() * sizeof(uint32_t) });
+    }
+
+    inline uint32_t get(const uint8_t* a, uint32_t i)
+    {
+        uint64_t bit = (uint64_t) i * slot_bits;
+        uint64_t v;
+        memcpy(&v, &TRACE_READ(a[bit >> 3]), sizeof(v));
+        return (v >> (bit & 7)) & slot_mask;
+    }
+
+    inline void set(uint8_t* a, uint32_t i, uint32_t value)
+    {
+        uint64_t bit = (uint64_t) i * slot_bits;
+        uint64_t v;
+        memcpy(&v, a + (bit >> 3), sizeof(v));
+        v &= ~(slot_mask << (bit & 7));
+        v |= (uint64_t) value << (bit & 7);
+        memcpy(a + (bit >> 3), &v, sizeof(v));
+    }
+
+    // round function j of the permutation of table i, 16 bits
+    inline uint32_t round_fn(int i, uint32_t j, uint32_t v)
+    {
+        uint32_t hv = i ? h->h2(v | (j << 16)) : h->h1(v | (j << 16));
+        return (hv ^ (hv >> 16)) & 0xFFFF;
+    }
+
+    inline uint32_t permute(int i, uint32_t x)
+    {
+        uint32_t l = x >> 16, r = x & 0xFFFF;
+        for (uint32_t j = 0; j < FEISTEL_ROUNDS; j++)
+        {
+            uint32_t tmp = l ^ round_fn(i, j, r);
+            l = r;
+            r = tmp;
+        }
+        return (l << 16) | r;
+    }
+
+    inline uint32_t unpermute(int i, uint32_t y)
+    {
+        uint32_t l = y >> 16, r = y & 0xFFFF;
+        for (uint32_t j = FEISTEL_ROUNDS; j-- > 0; )
+        {
+            uint32_t tmp = r ^ round_fn(i, j, l);
+            r = l;
+            l = tmp;
+        }
+        return (l << 16) | r;
+    }
+
+    bool lookup(uint32_t key)
+    {
+        TRACE_OPERATION;
+        for (int i = 0; i < 2; i++)
+        {
+            uint32_t y = permute(i, key);
+            if (get(t[i], y % m) == y / m + 1)
+                return true;
+        }
+        for (uint32_t i = 0; i < stash.size(); i++)
+        {
+            if (TRACE_READ(stash[i]) == key)
+                return true;
+        }
+        return false;
+    }
+
+    void insert(uint32_t key)
+    {
+        TRACE_OPERATION;
+        int i = 0;
+        for (uint16_t c = 0; c < MAXLOOP; c++)
+        {
+            uint32_t y = permute(i, key);
+            uint32_t slot = y % m;
+            uint32_t old = get(t[i], slot);
+            set(t[i], slot, y / m + 1);
+            if (old == 0)
+                return;
+            // the evicted key from its slot and quotient
+            key = unpermute(i, (old - 1) * m + slot);
+            i = 1 - i;
+        }
+        stash.push_back(key);
+    }
+
+    void remove(uint32_t key)
+    {
+        TRACE_OPERATION;
+        for (int i = 0; i < 2; i++)
+        {
+            uint32_t y = permute(i, key);
+            if (get(t[i], y % m) == y / m + 1)
+            {
+                set(t[i], y % m, 0);
+                return;
+            }
+        }
+        for (uint32_t i = 0; i < stash.size(); i++)
+        {
+            if (TRACE_READ(stash[i]) == key)
+            {
+                stash.erase(stash.begin() + i);
+                return;
+            }
+        }
+    }
+
+    void print_stats(std::ostream& os, uint32_t n)
+    {
+        os << " stash_size=" << stash.size()
+           << " slot_bits=" << slot_bits
+           << " bits_per_key=" << (n ? 2.0 * m * slot_bits / n : 0);
+    }
+}
+
+#endif // COMPACTCUCKOO_H
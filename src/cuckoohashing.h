@@ -0,0 +1,520 @@
+#ifndef CUCKOOHASHING_H
+#define CUCKOOHASHING_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <vector>
+#include <algorithm>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "hashfunctions.h"
+#include "random.h"
+
+#ifndef MAXLOOP
+#define MAXLOOP 1000
+#endif
+
+namespace cuckoohashing {
+
+    uint32_t* t1;
+    uint32_t* t2;
+
+    uint32_t m;
+
+    HashFunction* h;
+    std::vector<uint32_t> stash;
+
+    // how t1 and t2 were allocated: by init, by a resize (lazily zeroed
+    // pages, so growing does not stop to clear the new tables) or as part
+    // of a mapped snapshot
+    enum storage_t { NEW_ARRAY, CALLOC, MAPPED };
+    storage_t storage = NEW_ARRAY;
+
+    // Incremental resize: while old_t1 is set, t1 and t2 are the new tables
+    // and the slots of old_t1 and old_t2 below migrated have been moved
+    // into them already. Lookups and removes check both.
+    uint32_t* old_t1 = NULL;
+    uint32_t* old_t2 = NULL;
+    uint32_t old_m;
+    uint32_t migrated;
+    storage_t old_storage;
+
+    // keys inserted by insert_incremental, and finished resizes
+    uint64_t count;
+    uint32_t resizes;
+
+    // slot pairs moved per insert during the running resize, and the most
+    // of any resize
+    uint32_t migration_step;
+    uint32_t max_migration_step;
+
+    void init(uint32_t _m, HashFunction* _h) 
+    {
+        h = _h;
+        m = _m;
+        storage = NEW_ARRAY;
+        old_t1 = old_t2 = NULL;
+        count = 0;
+        resizes = 0;
+        migration_step = max_migration_step = 0;
+
+        t1 = new uint32_t[m];
+        t2 = new uint32_t[m];
+
+
+        for (uint32_t i = 0; i < m; i++)
+        {
+            t1[i] = 0;
+            t2[i] = 0;
+        }
+    }
+
+    void free_tables(uint32_t* a, uint32_t* b, storage_t s)
+    {
+        if (s == NEW_ARRAY)
+        {
+            delete[] a;
+            delete[] b;
+        }
+        else if (s == CALLOC)
+        {
+            free(a);
+            free(b);
+        }
+    }
+
+    void destroy()
+    {
+        free_tables(t1, t2, storage);
+        if (old_t1 != NULL)
+            free_tables(old_t1, old_t2, old_storage);
+        old_t1 = old_t2 = NULL;
+        stash.clear();
+    }
+
+    // append the memory of the tables and the stash
+    void memory_regions(std::vector<MemoryRegion>& regions)
+    {
+        regions.push_back(MemoryRegion{ t1, m * sizeof(uint32_t) });
+        regions.push_back(MemoryRegion{ t2, m * sizeof(uint32_t) });
+        regions.push_back(MemoryRegion{ stash.data(), stash.capacity() * sizeof(uint32_t) });
+        if (old_t1 != NULL)
+        {
+            regions.push_back(MemoryRegion{ old_t1, old_m * sizeof(uint32_t) });
+            regions.push_back(MemoryRegion{ old_t2, old_m * sizeof(uint32_t) });
+        }
+    }
+
+    bool lookup(uint32_t key)
+    {
+        TRACE_OPERATION;
+        if (TRACE_READ(t1[h->h1(key) % m]) == key)
+            return true;
+        if (TRACE_READ(t2[h->h2(key) % m]) == key)
+            return true;
+        if (old_t1 != NULL && (TRACE_READ(old_t1[h->h1(key) % old_m]) == key ||
+                               TRACE_READ(old_t2[h->h2(key) % old_m]) == key))
+            return true;
+        for (uint32_t i = 0; i < stash.size(); i++)
+	{
+            if (TRACE_READ(stash[i]) == key)
+	    {
+                return true;
+	    }
+        }
+	return false;
+    }
+
+#if defined(__AVX512F__)
+    const size_t BATCH_WIDTH = 16;
+#elif defined(__AVX2__)
+    const size_t BATCH_WIDTH = 8;
+#else
+    const size_t BATCH_WIDTH = 1;
+#endif
+
+    // keys per block of lookup_many in the current table, 1 if it looks
+    // them up one by one: without SIMD, during a resize, and for m >= 2^31
+    // since the gathers take signed 32-bit slot numbers
+    inline size_t batch_width()
+    {
+        return (old_t1 == NULL && m <= INT32_MAX) ? BATCH_WIDTH : 1;
+    }
+
+    // x % m in every lane, for m < 2^31: the quotient x * (1 / m) in double
+    // precision is off by at most one, which the remainder corrects
+#if defined(__AVX512F__)
+    // GCC 12 reports the _mm512_undefined operands inside the extract and
+    // conversion intrinsics as maybe-uninitialized
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+    inline __m512i mod_m(__m512i x, __m512d dm, __m512d inv)
+    {
+        const __m512d z = _mm512_setzero_pd();
+        __m256i half[2] = { _mm512_castsi512_si256(x), _mm512_extracti64x4_epi64(x, 1) };
+        for (int j = 0; j < 2; j++)
+        {
+            __m512d d = _mm512_cvtepu32_pd(half[j]);
+            __m512d q = _mm512_roundscale_pd(_mm512_mul_pd(d, inv), _MM_FROUND_TO_NEG_INF | _MM_FROUND_NO_EXC);
+            __m512d r = _mm512_sub_pd(d, _mm512_mul_pd(q, dm));
+            r = _mm512_mask_add_pd(r, _mm512_cmp_pd_mask(r, z, _CMP_LT_OQ), r, dm);
+            r = _mm512_mask_sub_pd(r, _mm512_cmp_pd_mask(r, dm, _CMP_GE_OQ), r, dm);
+            half[j] = _mm512_cvttpd_epi32(r);
+        }
+        return _mm512_inserti64x4(_mm512_castsi256_si512(half[0]), half[1], 1);
+    }
+#pragma GCC diagnostic pop
+#elif defined(__AVX2__)
+    inline __m256i mod_m(__m256i x, __m256d dm, __m256d inv)
+    {
+        const __m256d z = _mm256_setzero_pd();
+        const __m256d two32 = _mm256_set1_pd(4294967296.0);
+        __m128i half[2] = { _mm256_castsi256_si128(x), _mm256_extracti128_si256(x, 1) };
+        for (int j = 0; j < 2; j++)
+        {
+            // unsigned: lanes above 2^31 convert as negative
+            __m256d d = _mm256_cvtepi32_pd(half[j]);
+            d = _mm256_add_pd(d, _mm256_and_pd(_mm256_cmp_pd(d, z, _CMP_LT_OQ), two32));
+            __m256d q = _mm256_floor_pd(_mm256_mul_pd(d, inv));
+            __m256d r = _mm256_sub_pd(d, _mm256_mul_pd(q, dm));
+            r = _mm256_add_pd(r, _mm256_and_pd(_mm256_cmp_pd(r, z, _CMP_LT_OQ), dm));
+            r = _mm256_sub_pd(r, _mm256_and_pd(_mm256_cmp_pd(r, dm, _CMP_GE_OQ), dm));
+            half[j] = _mm256_cvttpd_epi32(r);
+        }
+        return _mm256_set_m128i(half[1], half[0]);
+    }
+#endif
+
+    // Membership of count keys at once: bit i % 64 of result[i / 64] is set
+    // if keys[i] is in the table. Both slots of a block of batch_width()
+    // keys are computed and reduced mod m first, then t1 and t2 are
+    // gathered and compared without branches; only keys found in neither
+    // table are looked up in the stash.
+    void lookup_many(const uint32_t* keys, size_t count, uint64_t* result)
+    {
+        for (size_t i = 0; i < (count + 63) / 64; i++)
+            result[i] = 0;
+
+        size_t i = 0;
+        const size_t W = batch_width();
+#if defined(__AVX512F__)
+        const __m512d dm = _mm512_set1_pd(m), inv = _mm512_set1_pd(1.0 / m);
+#elif defined(__AVX2__)
+        const __m256d dm = _mm256_set1_pd(m), inv = _mm256_set1_pd(1.0 / m);
+#endif
+        uint32_t i1[16], i2[16];
+        for ( ; W > 1 && i + W <= count; i += W)
+        {
+            h->h1_many(keys + i, i1, W);
+            h->h2_many(keys + i, i2, W);
+            uint64_t found;
+#if defined(__AVX512F__)
+            __m512i k = _mm512_loadu_si512(keys + i);
+            __m512i z = _mm512_setzero_si512();
+            __m512i a = _mm512_mask_i32gather_epi32(z, 0xFFFF, mod_m(_mm512_loadu_si512(i1), dm, inv), (const int*) t1, 4);
+            __m512i b = _mm512_mask_i32gather_epi32(z, 0xFFFF, mod_m(_mm512_loadu_si512(i2), dm, inv), (const int*) t2, 4);
+            found = _mm512_cmpeq_epi32_mask(a, k) | _mm512_cmpeq_epi32_mask(b, k);
+#elif defined(__AVX2__)
+            __m256i k = _mm256_loadu_si256((const __m256i*) (keys + i));
+            __m256i a = _mm256_i32gather_epi32((const int*) t1, mod_m(_mm256_loadu_si256((const __m256i*) i1), dm, inv), 4);
+            __m256i b = _mm256_i32gather_epi32((const int*) t2, mod_m(_mm256_loadu_si256((const __m256i*) i2), dm, inv), 4);
+            __m256i eq = _mm256_or_si256(_mm256_cmpeq_epi32(a, k), _mm256_cmpeq_epi32(b, k));
+            found = (uint32_t) _mm256_movemask_ps(_mm256_castsi256_ps(eq));
+#else
+            found = 0;
+#endif
+            if (!stash.empty())
+            {
+                for (size_t j = 0; j < W; j++)
+                {
+                    if (!((found >> j) & 1) &&
+                        std::find(stash.begin(), stash.end(), keys[i + j]) != stash.end())
+                        found |= (uint64_t) 1 << j;
+                }
+            }
+            // W divides 64, so a block never spans two words
+            result[i / 64] |= found << (i % 64);
+        }
+
+        for ( ; i < count; i++)
+        {
+            if (lookup(keys[i]))
+                result[i / 64] |= (uint64_t) 1 << (i % 64);
+        }
+    }
+
+    void remove(uint32_t key)
+    {
+        TRACE_OPERATION;
+        if (TRACE_READ(t1[h->h1(key) % m]) == key)
+            t1[h->h1(key) % m] = 0;
+        if (TRACE_READ(t2[h->h2(key) % m]) == key)
+            t2[h->h2(key) % m] = 0;
+        if (old_t1 != NULL)
+        {
+            if (old_t1[h->h1(key) % old_m] == key)
+                old_t1[h->h1(key) % old_m] = 0;
+            if (old_t2[h->h2(key) % old_m] == key)
+                old_t2[h->h2(key) % old_m] = 0;
+        }
+        for (uint32_t i = 0; i < stash.size(); i++)
+            if (TRACE_READ(stash[i]) == key)
+                stash.erase(stash.begin() + i); 
+    }
+
+    void insert(uint64_t key)
+    {
+        uint64_t tmp = 0;
+        uint64_t hash = 0;
+        uint8_t i = 1;
+        uint16_t c = 0;
+        TRACE_OPERATION;
+#ifdef DEBUG            
+        std::cout <<
+            "Key: " << key << 
+            " h1: " << h->h1(key) % m << 
+            " h2: " << h->h2(key) % m <<
+            std::endl;
+#endif
+
+        while (c < MAXLOOP)
+        {
+                
+            if (i == 1)
+            {
+                hash = h->h1(key) % m;
+                tmp = TRACE_READ(t1[hash]);
+                t1[hash] = key;
+            }
+            else
+            {
+                hash = h->h2(key) % m;
+                tmp = TRACE_READ(t2[hash]);
+                t2[hash] = key;
+            }
+            key = tmp;
+            if (key == 0)
+                break;
+            c++;
+            i = 3 - i;
+        }
+        if (key != 0)
+        {
+            stash.push_back(key);
+        }
+    }
+
+    // Single evaluation modes: both slots of a key come from one value of
+    // h1. SPLIT mixes h1(x) into two slots. FINGERPRINT takes the first
+    // slot from h1(x) and the second as (H(f) - i1) mod m for the 16-bit
+    // fingerprint f, the high half of h1(x), an involution for any m (the
+    // XOR trick of partial-key cuckoo hashing): an evicted key finds its
+    // other slot from the slot it leaves and h1 alone.
+    enum single_mode_t { TWO_FUNCTIONS, SPLIT, FINGERPRINT };
+
+    inline uint32_t split_first(uint32_t hv)
+    {
+        return ((uint64_t) hv * m) >> 32;
+    }
+
+    inline uint32_t split_second(uint32_t hv)
+    {
+        return ((uint64_t) (uint32_t) (rotl32(hv, 16) * 0x9E3779B1u) * m) >> 32;
+    }
+
+    // the slot hv % m mostly depends on the low bits of hv
+    inline uint32_t fingerprint(uint32_t hv)
+    {
+        return hv >> 16;
+    }
+
+    inline uint32_t alt(uint32_t i, uint32_t f)
+    {
+        uint32_t hf = ctrrng::mix64(f) % m;
+        return hf >= i ? hf - i : hf + m - i;
+    }
+
+    // both slots of key with one evaluation of h1
+    template <int MODE>
+    inline void single_slots(uint32_t key, uint32_t& i1, uint32_t& i2)
+    {
+        uint32_t hv = h->h1(key);
+        if (MODE == SPLIT)
+        {
+            i1 = split_first(hv);
+            i2 = split_second(hv);
+        }
+        else
+        {
+            i1 = hv % m;
+            i2 = alt(i1, fingerprint(hv));
+        }
+    }
+
+    template <int MODE>
+    bool lookup_single(uint32_t key)
+    {
+        TRACE_OPERATION;
+        uint32_t i1, i2;
+        single_slots<MODE>(key, i1, i2);
+        if (TRACE_READ(t1[i1]) == key || TRACE_READ(t2[i2]) == key)
+            return true;
+        return std::find(stash.begin(), stash.end(), key) != stash.end();
+    }
+
+    template <int MODE>
+    void remove_single(uint32_t key)
+    {
+        TRACE_OPERATION;
+        uint32_t i1, i2;
+        single_slots<MODE>(key, i1, i2);
+        if (TRACE_READ(t1[i1]) == key)
+            t1[i1] = 0;
+        if (TRACE_READ(t2[i2]) == key)
+            t2[i2] = 0;
+        std::vector<uint32_t>::iterator it = std::find(stash.begin(), stash.end(), key);
+        if (it != stash.end())
+            stash.erase(it);
+    }
+
+    // cuckoo insert as insert(), the evicted key goes to its slot in the
+    // other table
+    template <int MODE>
+    void insert_single(uint32_t key)
+    {
+        TRACE_OPERATION;
+        uint32_t pos, other;
+        single_slots<MODE>(key, pos, other);
+        uint32_t tmp;
+        uint8_t i = 1;
+        uint16_t c = 0;
+
+        while (c < MAXLOOP)
+        {
+            if (i == 1)
+            {
+                tmp = TRACE_READ(t1[pos]);
+                t1[pos] = key;
+            }
+            else
+            {
+                tmp = TRACE_READ(t2[pos]);
+                t2[pos] = key;
+            }
+            key = tmp;
+            if (key == 0)
+                break;
+            if (MODE == SPLIT)
+            {
+                uint32_t hv = h->h1(key);
+                pos = (i == 1) ? split_second(hv) : split_first(hv);
+            }
+            else
+            {
+                pos = alt(pos, fingerprint(h->h1(key)));
+            }
+            c++;
+            i = 3 - i;
+        }
+        if (key != 0)
+        {
+            stash.push_back(key);
+        }
+    }
+
+    // move the keys of the next slots slot pairs of the old tables into the
+    // new ones, all remaining for slots = 0; the stash is reinserted and the
+    // old tables are freed when the last slot has moved
+    void migrate(uint32_t slots)
+    {
+        uint32_t end = (slots == 0 || old_m - migrated < slots) ? old_m : migrated + slots;
+        for ( ; migrated < end; migrated++)
+        {
+            uint32_t k1 = old_t1[migrated], k2 = old_t2[migrated];
+            old_t1[migrated] = old_t2[migrated] = 0;
+            if (k1 != 0)
+                insert(k1);
+            if (k2 != 0)
+                insert(k2);
+        }
+        if (migrated < old_m)
+            return;
+
+        free_tables(old_t1, old_t2, old_storage);
+        old_t1 = old_t2 = NULL;
+        resizes++;
+
+        std::vector<uint32_t> old_stash;
+        old_stash.swap(stash);
+        for (size_t i = 0; i < old_stash.size(); i++)
+            insert(old_stash[i]);
+    }
+
+    // switch to empty tables of new_m slots, keeping the current ones as
+    // old tables to migrate from
+    void start_resize(uint32_t new_m)
+    {
+        if (old_t1 != NULL)
+            migrate(0);
+
+        old_t1 = t1;
+        old_t2 = t2;
+        old_m = m;
+        old_storage = storage;
+        migrated = 0;
+
+        m = new_m;
+        storage = CALLOC;
+        t1 = (uint32_t*) calloc(m, sizeof(uint32_t));
+        t2 = (uint32_t*) calloc(m, sizeof(uint32_t));
+    }
+
+    // true if the next insert into a growing table migrates or resizes
+    inline bool grow_pending(double max_load)
+    {
+        return old_t1 != NULL || count + 1 > max_load * 2 * m;
+    }
+
+    // The work of insert_incremental before the insert itself, true if
+    // there was any. A resize moves at least enough slot pairs per insert
+    // to finish before the doubled table reaches max_load, otherwise the
+    // next resize would move the rest at once.
+    bool grow(double max_load, uint32_t step)
+    {
+        bool res = (old_t1 != NULL);
+        if (old_t1 != NULL)
+            migrate(migration_step);
+        if (count + 1 > max_load * 2 * m)
+        {
+            res = true;
+            start_resize(2 * m);
+            uint64_t inserts = (uint64_t) (max_load * 2 * m) - count;
+            migration_step = (step == 0) ? 0 : std::max((uint64_t) step, (old_m + inserts - 1) / inserts);
+            max_migration_step = std::max(max_migration_step, migration_step);
+            if (step == 0)
+                migrate(0);
+        }
+        return res;
+    }
+
+    // the insert of insert_incremental, after grow()
+    void insert_counted(uint64_t key)
+    {
+        insert(key);
+        count++;
+    }
+
+    // Insert into a growing table: every insert first moves step slot pairs
+    // of a running resize, and the table doubles once the load would exceed
+    // max_load. step = 0 migrates all keys at once (stop the world).
+    void insert_incremental(uint64_t key, double max_load, uint32_t step)
+    {
+        grow(max_load, step);
+        insert_counted(key);
+    }
+}
+
+#endif // CUCKOOHASHING_H
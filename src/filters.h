@@ -0,0 +1,265 @@
+#ifndef FILTERS_H
+#define FILTERS_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <iostream>
+
+#include "hashfunctions.h"
+#include "random.h"
+
+#ifndef MAXKICKS
+#define MAXKICKS 500
+#endif
+
+// Partial-key cuckoo filter with buckets of 4 16-bit fingerprints. The
+// first bucket of x is h1(x), the fingerprint is taken from the high bits
+// of h2(x), and the alternate bucket of a fingerprint f in bucket i is
+// (h1(f) - i) mod nb, which is an involution for any number of buckets.
+namespace cuckoofilter {
+
+    static const uint32_t SLOTS = 4;
+
+    uint16_t* t;
+
+    uint32_t nb;
+
+    HashFunction* h;
+    ctrrng::Stream* rand;
+
+    // fingerprint evicted by a failed insert, 0 if none
+    uint16_t victim;
+    uint32_t victim_bucket;
+    // inserts rejected while the victim slot was taken
+    uint64_t failures;
+
+    // create a filter for n keys at 95% load
+    void init(uint32_t n, HashFunction* _h)
+    {
+        h = _h;
+        nb = (uint32_t) (n / (SLOTS * 0.95)) + 1;
+
+        t = new uint16_t[nb * SLOTS];
+
+        for (uint32_t i = 0; i < nb * SLOTS; i++)
+        {
+            t[i] = 0;
+        }
+
+        rand = new ctrrng::Stream(g_gen(), 0);
+        victim = 0;
+        victim_bucket = 0;
+        failures = 0;
+    }
+
+    void destroy()
+    {
+        delete[] t;
+        delete rand;
+    }
+
+    void memory_regions(std::vector<MemoryRegion>& regions)
+    {
+        regions.push_back(MemoryRegion{ t, (size_t) nb * SLOTS * sizeof(uint16_t) });
+    }
+
+    inline uint16_t fingerprint(uint32_t x)
+    {
+        uint16_t f = h->h2(x) >> 16;
+        return f ? f : 1;
+    }
+
+    inline uint32_t alt(uint32_t i, uint16_t f)
+    {
+        uint32_t hf = h->h1(f) % nb;
+        return hf >= i ? hf - i : hf + nb - i;
+    }
+
+    inline bool contains(uint32_t i, uint16_t f)
+    {
+        const uint16_t* b = t + i * SLOTS;
+        return (b[0] == f) | (b[1] == f) | (b[2] == f) | (b[3] == f);
+    }
+
+    inline bool put(uint32_t i, uint16_t f)
+    {
+        uint16_t* b = t + i * SLOTS;
+        for (uint32_t s = 0; s < SLOTS; s++)
+        {
+            if (b[s] == 0)
+            {
+                b[s] = f;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool lookup(uint32_t x)
+    {
+        uint16_t f = fingerprint(x);
+        uint32_t i1 = h->h1(x) % nb;
+        if (contains(i1, f))
+            return true;
+        uint32_t i2 = alt(i1, f);
+        return contains(i2, f) ||
+            (victim == f && (victim_bucket == i1 || victim_bucket == i2));
+    }
+
+    // insert x, false if the filter is full and x was not added
+    bool insert(uint32_t x)
+    {
+        uint16_t f = fingerprint(x);
+        uint32_t i = h->h1(x) % nb;
+        if (put(i, f))
+            return true;
+        i = alt(i, f);
+        if (put(i, f))
+            return true;
+
+        // with the victim slot taken, a kick chain could drop a fingerprint
+        if (victim != 0)
+        {
+            failures++;
+            return false;
+        }
+
+        for (uint32_t c = 0; c < MAXKICKS; c++)
+        {
+            uint16_t* b = t + i * SLOTS + rand->next(SLOTS);
+            uint16_t tmp = *b;
+            *b = f;
+            f = tmp;
+            i = alt(i, f);
+            if (put(i, f))
+                return true;
+        }
+
+        // the filter is full, keep the last fingerprint aside; x is in the
+        // filter, either in a bucket or as the victim
+        victim = f;
+        victim_bucket = i;
+        return true;
+    }
+
+    void remove(uint32_t x)
+    {
+        uint16_t f = fingerprint(x);
+        uint32_t i1 = h->h1(x) % nb;
+        uint32_t i2 = alt(i1, f);
+        for (uint32_t s = 0; s < SLOTS; s++)
+        {
+            if (t[i1 * SLOTS + s] == f)
+            {
+                t[i1 * SLOTS + s] = 0;
+                return;
+            }
+        }
+        for (uint32_t s = 0; s < SLOTS; s++)
+        {
+            if (t[i2 * SLOTS + s] == f)
+            {
+                t[i2 * SLOTS + s] = 0;
+                return;
+            }
+        }
+        if (victim == f && (victim_bucket == i1 || victim_bucket == i2))
+            victim = 0;
+    }
+
+    uint64_t size_in_bits()
+    {
+        return (uint64_t) nb * SLOTS * 16;
+    }
+
+    void print_stats(std::ostream& os)
+    {
+        // keys rejected by a full filter, they count as false negatives
+        os << " insert_failures=" << failures;
+    }
+}
+
+// Bloom filter blocked into 512-bit cache lines. The block of x is h1(x),
+// its k bits inside the block are derived from h2(x) by double hashing.
+namespace bloomfilter {
+
+    static const uint32_t BLOCK_WORDS = 8;
+
+    uint64_t* t;
+
+    uint32_t nblocks;
+    uint32_t k;
+
+    HashFunction* h;
+
+    // create a filter of at least bits bits with k bits set per key
+    void init(uint64_t bits, uint32_t _k, HashFunction* _h)
+    {
+        h = _h;
+        k = _k;
+        nblocks = (bits + 511) / 512;
+
+        void* p;
+        if (posix_memalign(&p, 64, (size_t) nblocks * BLOCK_WORDS * sizeof(uint64_t)))
+        {
+            std::cerr << "bloomfilter: cannot allocate " << nblocks << " blocks" << std::endl;
+            abort();
+        }
+        t = (uint64_t*) p;
+
+        for (uint64_t i = 0; i < (uint64_t) nblocks * BLOCK_WORDS; i++)
+        {
+            t[i] = 0;
+        }
+    }
+
+    void destroy()
+    {
+        free(t);
+    }
+
+    void memory_regions(std::vector<MemoryRegion>& regions)
+    {
+        regions.push_back(MemoryRegion{ t, (size_t) nblocks * BLOCK_WORDS * sizeof(uint64_t) });
+    }
+
+    void insert(uint32_t x)
+    {
+        uint64_t* b = t + (uint64_t) (h->h1(x) % nblocks) * BLOCK_WORDS;
+        uint32_t g = h->h2(x);
+        uint32_t pos = g >> 23;
+        uint32_t step = ((g >> 14) & 511) | 1;
+        for (uint32_t i = 0; i < k; i++)
+        {
+            b[pos >> 6] |= 1ULL << (pos & 63);
+            pos = (pos + step) & 511;
+        }
+    }
+
+    bool lookup(uint32_t x)
+    {
+        const uint64_t* b = t + (uint64_t) (h->h1(x) % nblocks) * BLOCK_WORDS;
+        uint32_t g = h->h2(x);
+        uint32_t pos = g >> 23;
+        uint32_t step = ((g >> 14) & 511) | 1;
+        bool res = true;
+        for (uint32_t i = 0; i < k; i++)
+        {
+            res &= (b[pos >> 6] >> (pos & 63)) & 1;
+            pos = (pos + step) & 511;
+        }
+        return res;
+    }
+
+    uint64_t size_in_bits()
+    {
+        return (uint64_t) nblocks * 512;
+    }
+
+    void print_stats(std::ostream& os)
+    {
+        os << " bloom_k=" << k;
+    }
+}
+
+#endif // FILTERS_H
@@ -0,0 +1,301 @@
+#include<vector>
+#include<cmath>
+#include<string>
+#include <unistd.h>
+#include <boost/random.hpp>
+
+static boost::mt19937_64 g_gen;
+
+#include "hashfunctions.h"
+#include "tools/timer.h"
+#include "tools/cache.h"
+#include "tools/memory.h"
+#include "keys.h"
+#include "methods.h"
+
+// Benchmark of the hash functions alone, without a table. Every method is
+// timed on batches of keys
+//  - as independent stream (throughput), as dependent chain, where
+//    each key is xored with the previous hash value (latency), and with
+//    one h1_many call per batch (batch),
+//  - warm, after an untimed pass over all batches, timed in one interval
+//    over all batches, and cold, after evicting all caches before every
+//    batch, timed per batch less the cost of reading the clock.
+// Calls are non-virtual so the compiler can inline the hash function.
+
+#define POOL_SIZE (1 << 20)
+#define KEYS_PER_CONFIG (1 << 22)
+#define COLD_REPS 100
+
+static const uint32_t batch_sizes[] = { 16, 256, 4096, 65536 };
+
+static const char* mode_names[] = { "throughput", "latency", "batch" };
+
+static uint32_t batch_out[65536];
+
+CacheEvictor* evictor;
+
+// seconds of an empty timer interval, the least of 1000
+double timer_overhead()
+{
+    double res = 1;
+    for (int i = 0; i < 1000; i++)
+    {
+        ClockIntervalBase<CLOCK_MONOTONIC> timer;
+        timer.start();
+        timer.stop();
+        res = std::min(res, timer.delta());
+    }
+    return res;
+}
+
+double g_timer_overhead;
+
+template <typename T>
+inline uint32_t hash_stream(T& f, const uint32_t* keys, uint32_t batch)
+{
+    uint32_t acc = 0;
+    for (uint32_t i = 0; i < batch; i++)
+    {
+        acc ^= f.T::h1(keys[i]);
+    }
+    return acc;
+}
+
+template <typename T>
+inline uint32_t hash_chain(T& f, const uint32_t* keys, uint32_t batch)
+{
+    uint32_t x = 0;
+    for (uint32_t i = 0; i < batch; i++)
+    {
+        x = f.T::h1(keys[i] ^ x);
+    }
+    return x;
+}
+
+template <typename T>
+inline uint32_t hash_batch(T& f, const uint32_t* keys, uint32_t batch)
+{
+    f.T::h1_many(keys, batch_out, batch);
+    uint32_t acc = 0;
+    for (uint32_t i = 0; i < batch; i++)
+    {
+        acc ^= batch_out[i];
+    }
+    return acc;
+}
+
+template <typename T>
+inline uint32_t hash_mode(T& f, int mode, const uint32_t* keys, uint32_t batch)
+{
+    switch (mode)
+    {
+        case 0:
+            return hash_stream(f, keys, batch);
+        case 1:
+            return hash_chain(f, keys, batch);
+        default:
+            return hash_batch(f, keys, batch);
+    }
+}
+
+template <typename T>
+void bench(T& f, int method, uint32_t seed, uint32_t n, const std::vector<uint32_t>& keys)
+{
+    std::vector<MemoryRegion> regions;
+    f.getMemoryRegions(regions);
+    size_t hash_bytes = 0;
+    for (size_t i = 0; i < regions.size(); i++)
+        hash_bytes += regions[i].bytes;
+
+    for (int mode = 0; mode < 3; mode++)
+    {
+        for (int cold = 0; cold < 2; cold++)
+        {
+            for (size_t b = 0; b < sizeof(batch_sizes) / sizeof(batch_sizes[0]); b++)
+            {
+                uint32_t batch = batch_sizes[b];
+                uint32_t reps = KEYS_PER_CONFIG / batch;
+                if (cold && reps > COLD_REPS)
+                    reps = COLD_REPS;
+
+                double time = 0;
+                ClockIntervalBase<CLOCK_MONOTONIC> timer;
+                if (!cold)
+                {
+                    for (uint32_t r = 0; r < reps; r++)
+                        escape(hash_mode(f, mode, &keys[((uint64_t) r * batch) % POOL_SIZE], batch));
+
+                    uint32_t res = 0;
+                    timer.start();
+                    for (uint32_t r = 0; r < reps; r++)
+                        res ^= hash_mode(f, mode, &keys[((uint64_t) r * batch) % POOL_SIZE], batch);
+                    timer.stop();
+                    escape(res);
+                    time = timer.delta();
+                }
+                else
+                {
+                    for (uint32_t r = 0; r < reps; r++)
+                    {
+                        const uint32_t* k = &keys[((uint64_t) r * batch) % POOL_SIZE];
+                        evictor->evict();
+
+                        timer.start();
+                        uint32_t res = hash_mode(f, mode, k, batch);
+                        timer.stop();
+                        escape(res);
+                        time += std::max(0.0, timer.delta() - g_timer_overhead);
+                    }
+                }
+
+                std::cout <<
+                    " n=" << n <<
+                    " seed=" << seed <<
+                    " h=" << method <<
+                    " name=" << f.getDescription() <<
+                    " hash_bytes=" << hash_bytes <<
+                    " mode=" << mode_names[mode] <<
+                    " state=" << (cold ? "cold" : "warm") <<
+                    " batch=" << batch <<
+                    " reps=" << reps <<
+                    " ns_per_key=" << time * 1e9 / ((double) reps * batch) <<
+                    std::endl;
+            }
+        }
+    }
+}
+
+template <typename T>
+void bench_new(uint32_t seed, uint32_t n, const std::vector<uint32_t>& keys)
+{
+    T* f = new T();
+    bench(*f, -1, seed, n, keys);
+    delete f;
+}
+
+// simple tabulation over character widths, output widths and compressed
+// entries, to relate the size of the tables (hash_bytes) to the speed
+void sweep_simple_tab(uint32_t seed, uint32_t n, const std::vector<uint32_t>& keys)
+{
+    bench_new<SimpleTab<4> >(seed, n, keys);
+    bench_new<SimpleTab<6> >(seed, n, keys);
+    bench_new<SimpleTab<8> >(seed, n, keys);
+    bench_new<SimpleTab<11> >(seed, n, keys);
+    bench_new<SimpleTab<16> >(seed, n, keys);
+    bench_new<SimpleTab<8, 32, 16> >(seed, n, keys);
+    bench_new<SimpleTab<11, 32, 16> >(seed, n, keys);
+    bench_new<SimpleTab<16, 32, 16> >(seed, n, keys);
+    bench_new<SimpleTab<11, 16> >(seed, n, keys);
+    bench_new<SimpleTab<11, 64> >(seed, n, keys);
+    bench_new<SimpleTab<16, 64> >(seed, n, keys);
+}
+
+int main(int argc, char** argv)
+{
+    int only_method = -1;
+    uint32_t evict_mb = 64;
+    bool sweep = false;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "m:c:T")) != -1)
+    {
+        switch (opt)
+        {
+            case 'm':
+                only_method = atoi(optarg);
+                break;
+            case 'c':
+                evict_mb = atoi(optarg);
+                break;
+            case 'T':
+                sweep = true;
+                break;
+            default:
+                return 0;
+        }
+    }
+    argv += optind - 1;
+    argc -= optind - 1;
+
+    if (argc < 2 || argc > 3)
+    {
+        std::cout << "Usage: [-m method] [-c evict_mb] [-T] seed [n]" << std::endl;
+        std::cout << "Benchmarks the hash functions without a table. n sets the table sizes\n"
+                  << "of the ADW constructions (default 2^22). -c sets the size of the buffer\n"
+                  << "used to evict the caches in cold runs (default 64 MB). -T sweeps simple\n"
+                  << "tabulation over character, output and entry widths instead (h=-1)." << std::endl;
+        std::cout << "Available Methods: \n";
+        print_methods(std::cout);
+        return 0;
+    }
+
+    uint32_t seed = atoi(argv[1]);
+    uint32_t n = (argc == 3) ? atoi(argv[2]) : (1 << 22);
+
+    g_gen.seed(seed);
+
+    std::vector<uint32_t> keys = create_keys(POOL_SIZE);
+    shuffle_keys(keys, seed);
+
+    evictor = new CacheEvictor((size_t) evict_mb << 20);
+    g_timer_overhead = timer_overhead();
+
+    if (sweep)
+    {
+        sweep_simple_tab(seed, n, keys);
+        delete evictor;
+        return 0;
+    }
+
+    for (int method = 0; method < NUM_METHODS; method++)
+    {
+        if (only_method >= 0 && method != only_method)
+            continue;
+
+        HashFunction* h = create_hash_function(method, n);
+
+        switch (method)
+        {
+            case 0:
+                bench(*static_cast<SimpleTab8*>(h), method, seed, n, keys);
+                break;
+            case 1:
+                bench(*static_cast<SimpleTab16*>(h), method, seed, n, keys);
+                break;
+            case 2:
+                bench(*static_cast<Murmur3*>(h), method, seed, n, keys);
+                break;
+            case 3:
+            case 4:
+                bench(*static_cast<PolK*>(h), method, seed, n, keys);
+                break;
+            case 5:
+            case 6:
+            case 7:
+            case 8:
+                bench(*static_cast<ADW*>(h), method, seed, n, keys);
+                break;
+            case 9:
+            case 10:
+            case 11:
+                bench(*static_cast<ADWunfixed*>(h), method, seed, n, keys);
+                break;
+            case 12:
+                bench(*static_cast<FullyRandom*>(h), method, seed, n, keys);
+                break;
+            case 13:
+                bench(*static_cast<SimpleTab<11>*>(h), method, seed, n, keys);
+                break;
+            case 14:
+                bench(*static_cast<SimpleTab<11, 32, 16>*>(h), method, seed, n, keys);
+                break;
+        }
+
+        delete h;
+    }
+
+    delete evictor;
+
+    return 0;
+}
@@ -1,7 +1,19 @@
+#ifndef HASHFUNCTIONS_H
+#define HASHFUNCTIONS_H
+
 #include <stdint.h>
+#include <string.h>
 #include <string>
 #include <iostream>
 #include <vector>
+#include <algorithm>
+
+#if defined(__AVX512F__) || defined(__AVX2__)
+#include <immintrin.h>
+#endif
+
+#include "tools/cachesim.h"
+#include "random.h"
 
 static inline uint32_t rotl32 ( uint32_t x, int8_t r )
 {
@@ -10,6 +22,19 @@ static inline uint32_t rotl32 ( uint32_t x, int8_t r )
 
 #define ROTL32(x,y) rotl32(x,y)
 
+// binary output and input of count values, used by saveState/loadState
+template <typename T>
+inline void write_raw(std::ostream& os, const T* p, size_t count = 1)
+{
+    os.write((const char*) p, count * sizeof(T));
+}
+
+template <typename T>
+inline bool read_raw(std::istream& is, T* p, size_t count = 1)
+{
+    return (bool) is.read((char*) p, count * sizeof(T));
+}
+
 namespace multshift32 {
     
     inline uint32_t hash(uint32_t x, uint32_t l, uint32_t a)
@@ -35,11 +60,53 @@ namespace multshift2wise {
     }
 }
 
+// a block of memory held by a hash function or a table
+struct MemoryRegion {
+    const void* ptr;
+    size_t bytes;
+};
+
 class HashFunction {
     public:
+        virtual ~HashFunction() {}
         virtual uint32_t h1(uint32_t x) = 0;
         virtual uint32_t h2(uint32_t x) = 0;
         virtual std::string getDescription() = 0;
+
+        // h1 and h2 of count keys, for constructions that evaluate several
+        // keys at once
+        virtual void h1_many(const uint32_t* x, uint32_t* out, size_t count)
+        {
+            for (size_t i = 0; i < count; i++)
+                out[i] = h1(x[i]);
+        }
+
+        virtual void h2_many(const uint32_t* x, uint32_t* out, size_t count)
+        {
+            for (size_t i = 0; i < count; i++)
+                out[i] = h2(x[i]);
+        }
+
+        // append the memory holding the state of the hash function,
+        // including the object itself
+        virtual void getMemoryRegions(std::vector<MemoryRegion>& regions)
+        {
+            regions.push_back(MemoryRegion{ this, sizeof(*this) });
+        }
+
+        // write all parameters (seeds, coefficients, tables) in binary form
+        virtual void saveState(std::ostream&)
+        {
+        }
+
+        // read the parameters written by saveState of an object of the same
+        // construction, false if they do not fit this object. Objects that
+        // get their state this way are constructed with draw = false, which
+        // allocates the tables but draws nothing from g_gen.
+        virtual bool loadState(std::istream&)
+        {
+            return true;
+        }
 };
 
 
@@ -47,18 +114,18 @@ class HashFunction {
 class Pol3: public HashFunction {
     public:
         
-        Pol3()
+        Pol3(bool draw = true)
         {
             p = (1LL<<48) - 1; 
             boost::uniform_int<uint64_t> dis(0, p);
             boost::variate_generator<boost::mt19937_64&,boost::uniform_int<uint64_t> > rand (g_gen, dis);
 
-            a1 = rand();
-            a2 = rand();
-            b1 = rand();
-            b2 = rand();
-            c1 = rand();
-            c2 = rand();
+            a1 = draw ? rand() : 0;
+            a2 = draw ? rand() : 0;
+            b1 = draw ? rand() : 0;
+            b2 = draw ? rand() : 0;
+            c1 = draw ? rand() : 0;
+            c2 = draw ? rand() : 0;
             
         }
 
@@ -77,6 +144,26 @@ class Pol3: public HashFunction {
             return "Pol3";
         }
 
+        void getMemoryRegions(std::vector<MemoryRegion>& regions)
+        {
+            regions.push_back(MemoryRegion{ this, sizeof(*this) });
+        }
+
+        void saveState(std::ostream& os)
+        {
+            uint64_t v[6] = { a1, a2, b1, b2, c1, c2 };
+            write_raw(os, v, 6);
+        }
+
+        bool loadState(std::istream& is)
+        {
+            uint64_t v[6];
+            if (!read_raw(is, v, 6))
+                return false;
+            a1 = v[0], a2 = v[1], b1 = v[2], b2 = v[3], c1 = v[4], c2 = v[5];
+            return true;
+        }
+
     private:
         uint64_t a1, a2, b1, b2, c1, c2, p;
 
@@ -84,7 +171,7 @@ class Pol3: public HashFunction {
 
 class PolK: public HashFunction {
     public:
-        PolK(uint32_t _k)
+        PolK(uint32_t _k, bool draw = true)
         {
             k = _k;
             p = (1LL<<61) - 1; 
@@ -97,8 +184,8 @@ class PolK: public HashFunction {
 
             for (uint32_t i = 0; i < k; i++)
             {
-                a1[i] = rand();
-                a2[i] = rand();
+                a1[i] = draw ? rand() : 0;
+                a2[i] = draw ? rand() : 0;
             }
         }
 
@@ -126,10 +213,10 @@ class PolK: public HashFunction {
 
         uint32_t h1(uint32_t x)
         {
-            uint64_t res = a1[0];
+            uint64_t res = TRACE_READ(a1[0]);
             for (uint32_t i = 1; i < k; i++)
             {
-                res = cwtrick(x, res, a1[i]);
+                res = cwtrick(x, res, TRACE_READ(a1[i]));
             }
             res = (res & p) + (res >> 61);
             if (res >= p)
@@ -141,10 +228,10 @@ class PolK: public HashFunction {
 
         uint32_t h2(uint32_t x)
         {
-            uint64_t res = a2[0];
+            uint64_t res = TRACE_READ(a2[0]);
             for (uint32_t i = 1; i < k; i++)
             {
-                res = cwtrick(x, res, a2[i]);
+                res = cwtrick(x, res, TRACE_READ(a2[i]));
             }
             res = (res & p) + (res >> 61);
             if (res >= p)
@@ -154,23 +241,145 @@ class PolK: public HashFunction {
             return (uint32_t) res;
         }
 
+        // Horner chains of 8 (AVX-512) or 4 (AVX2) keys run in parallel on
+        // 64-bit lanes; cwtrick only needs 32x32->64 bit multiplies, so the
+        // result is bit-identical to h1 and h2
+        void h1_many(const uint32_t* x, uint32_t* out, size_t count)
+        {
+            eval_many(a1, x, out, count);
+            for (size_t i = count - count % LANES; i < count; i++)
+                out[i] = h1(x[i]);
+        }
+
+        void h2_many(const uint32_t* x, uint32_t* out, size_t count)
+        {
+            eval_many(a2, x, out, count);
+            for (size_t i = count - count % LANES; i < count; i++)
+                out[i] = h2(x[i]);
+        }
+
         std::string getDescription()
         {
             return "k-ind-cw";
         }
 
+        void getMemoryRegions(std::vector<MemoryRegion>& regions)
+        {
+            regions.push_back(MemoryRegion{ this, sizeof(*this) });
+            regions.push_back(MemoryRegion{ a1, k * sizeof(uint64_t) });
+            regions.push_back(MemoryRegion{ a2, k * sizeof(uint64_t) });
+        }
+
+        void saveState(std::ostream& os)
+        {
+            write_raw(os, &k);
+            write_raw(os, a1, k);
+            write_raw(os, a2, k);
+        }
+
+        bool loadState(std::istream& is)
+        {
+            uint32_t _k;
+            return read_raw(is, &_k) && _k == k && read_raw(is, a1, k) && read_raw(is, a2, k);
+        }
+
     private:
         uint32_t k;
         uint64_t p;
         uint64_t* a1;
         uint64_t* a2;
+
+#if defined(__AVX512F__)
+        static const size_t LANES = 8;
+
+        // GCC 12 reports the _mm512_undefined operands inside the
+        // conversion intrinsics as maybe-uninitialized
+#pragma GCC diagnostic push
+#pragma GCC diagnostic ignored "-Wmaybe-uninitialized"
+        // evaluate the polynomial a on all full blocks of LANES keys
+        void eval_many(const uint64_t* a, const uint32_t* x, uint32_t* out, size_t count)
+        {
+            const __m512i P = _mm512_set1_epi64(p);
+            for (size_t i = 0; i + LANES <= count; i += LANES)
+            {
+                __m512i vx = _mm512_cvtepu32_epi64(_mm256_loadu_si256((const __m256i*) (x + i)));
+                __m512i res = _mm512_set1_epi64(a[0]);
+                for (uint32_t j = 1; j < k; j++)
+                {
+                    __m512i a0 = _mm512_mul_epu32(res, vx);
+                    __m512i a1 = _mm512_mul_epu32(_mm512_srli_epi64(res, 32), vx);
+                    __m512i c0 = _mm512_add_epi64(a0, _mm512_slli_epi64(a1, 32));
+                    __m512i c1 = _mm512_add_epi64(_mm512_srli_epi64(a0, 32), a1);
+                    res = _mm512_add_epi64(_mm512_add_epi64(_mm512_and_si512(c0, P),
+                                                            _mm512_srli_epi64(c1, 29)),
+                                           _mm512_set1_epi64(a[j]));
+                }
+                res = _mm512_add_epi64(_mm512_and_si512(res, P), _mm512_srli_epi64(res, 61));
+                res = _mm512_min_epu64(res, _mm512_sub_epi64(res, P));
+                _mm256_storeu_si256((__m256i*) (out + i), _mm512_cvtepi64_epi32(res));
+            }
+        }
+#pragma GCC diagnostic pop
+#elif defined(__AVX2__)
+        static const size_t LANES = 4;
+
+        // evaluate the polynomial a on all full blocks of LANES keys
+        void eval_many(const uint64_t* a, const uint32_t* x, uint32_t* out, size_t count)
+        {
+            const __m256i P = _mm256_set1_epi64x(p);
+            const __m256i low = _mm256_setr_epi32(0, 2, 4, 6, 0, 2, 4, 6);
+            for (size_t i = 0; i + LANES <= count; i += LANES)
+            {
+                __m256i vx = _mm256_cvtepu32_epi64(_mm_loadu_si128((const __m128i*) (x + i)));
+                __m256i res = _mm256_set1_epi64x(a[0]);
+                for (uint32_t j = 1; j < k; j++)
+                {
+                    __m256i a0 = _mm256_mul_epu32(res, vx);
+                    __m256i a1 = _mm256_mul_epu32(_mm256_srli_epi64(res, 32), vx);
+                    __m256i c0 = _mm256_add_epi64(a0, _mm256_slli_epi64(a1, 32));
+                    __m256i c1 = _mm256_add_epi64(_mm256_srli_epi64(a0, 32), a1);
+                    res = _mm256_add_epi64(_mm256_add_epi64(_mm256_and_si256(c0, P),
+                                                            _mm256_srli_epi64(c1, 29)),
+                                           _mm256_set1_epi64x(a[j]));
+                }
+                res = _mm256_add_epi64(_mm256_and_si256(res, P), _mm256_srli_epi64(res, 61));
+                // res < 2^62, so the signed compare is exact
+                res = _mm256_sub_epi64(res, _mm256_andnot_si256(_mm256_cmpgt_epi64(P, res), P));
+                _mm_storeu_si128((__m128i*) (out + i),
+                                 _mm256_castsi256_si128(_mm256_permutevar8x32_epi32(res, low)));
+            }
+        }
+#else
+        static const size_t LANES = 4;
+
+        // interleave the Horner chains of LANES keys
+        void eval_many(const uint64_t* a, const uint32_t* x, uint32_t* out, size_t count)
+        {
+            for (size_t i = 0; i + LANES <= count; i += LANES)
+            {
+                uint64_t res[LANES];
+                for (size_t l = 0; l < LANES; l++)
+                    res[l] = a[0];
+                for (uint32_t j = 1; j < k; j++)
+                {
+                    for (size_t l = 0; l < LANES; l++)
+                        res[l] = cwtrick(x[i + l], res[l], a[j]);
+                }
+                for (size_t l = 0; l < LANES; l++)
+                {
+                    uint64_t r = (res[l] & p) + (res[l] >> 61);
+                    out[i + l] = (uint32_t) (r >= p ? r - p : r);
+                }
+            }
+        }
+#endif
 };
 
 class ADWunfixed: public HashFunction 
 {
     public:
 
-        ADWunfixed(unsigned short _k, unsigned short _c, uint32_t _l)
+        ADWunfixed(unsigned short _k, unsigned short _c, uint32_t _l, bool draw = true)
         {
             c = _c;
             l = _l;
@@ -178,24 +387,18 @@ class ADWunfixed: public HashFunction
             size = 1 << l;
 
             z = new uint32_t[2 * c * size];
-            
-            boost::uniform_int<uint32_t> dis(0, std::numeric_limits<uint32_t>::max());
-            boost::variate_generator<boost::mt19937_64&,boost::uniform_int<uint32_t> > rand (g_gen, dis);
 
-            f = new PolK(k);
+            f = new PolK(k, draw);
             g.reserve(k);
 
             for (uint32_t i = 0; i < c; i++)
             {
-                g.push_back(new PolK(k));
-            }
-
-            for (uint32_t i = 0; i < (2 * c * size); i++)
-            {
-                // fill table with random values
-                z[i] = rand();    
+                g.push_back(new PolK(k, draw));
             }
 
+            // fill table with random values
+            if (draw)
+                ctrrng::fill(z, 2 * c * size, g_gen(), 0);
         }
 
         virtual ~ADWunfixed()
@@ -213,7 +416,7 @@ class ADWunfixed: public HashFunction
             uint32_t res = f->h1(x); 
             for (uint32_t i = 0; i < c; i++)
             {
-                res += z[i * size + (g[i]->h1(x) >> (32 - l))];
+                res += TRACE_READ(z[i * size + (g[i]->h1(x) >> (32 - l))]);
             }
 
             return (uint32_t) res;
@@ -224,13 +427,24 @@ class ADWunfixed: public HashFunction
             uint32_t res = f->h2(x); 
             for (uint32_t i = 0; i < c; i++)
             {
-                res += z[(c + i) * size + (g[i]->h1(x) >> (32 - l))];
+                res += TRACE_READ(z[(c + i) * size + (g[i]->h1(x) >> (32 - l))]);
             }
 
             return (uint32_t) res;
         }
 
         
+        // blocks of keys through the batch evaluation of f and the g[i]
+        void h1_many(const uint32_t* x, uint32_t* out, size_t count)
+        {
+            eval_many(x, out, count, false);
+        }
+
+        void h2_many(const uint32_t* x, uint32_t* out, size_t count)
+        {
+            eval_many(x, out, count, true);
+        }
+
         std::string getDescription()
         {
             std::ostringstream convert; 
@@ -238,6 +452,44 @@ class ADWunfixed: public HashFunction
             return convert.str();
         }
 
+        void getMemoryRegions(std::vector<MemoryRegion>& regions)
+        {
+            regions.push_back(MemoryRegion{ this, sizeof(*this) });
+            regions.push_back(MemoryRegion{ z, 2 * c * size * sizeof(uint32_t) });
+            f->getMemoryRegions(regions);
+            for (uint32_t i = 0; i < c; i++)
+            {
+                g[i]->getMemoryRegions(regions);
+            }
+        }
+
+        void saveState(std::ostream& os)
+        {
+            uint32_t v[3] = { c, k, l };
+            write_raw(os, v, 3);
+            write_raw(os, z, 2 * c * size);
+            f->saveState(os);
+            for (uint32_t i = 0; i < c; i++)
+            {
+                g[i]->saveState(os);
+            }
+        }
+
+        bool loadState(std::istream& is)
+        {
+            uint32_t v[3];
+            if (!read_raw(is, v, 3) || v[0] != c || v[1] != k || v[2] != l)
+                return false;
+            if (!read_raw(is, z, 2 * c * size) || !f->loadState(is))
+                return false;
+            for (uint32_t i = 0; i < c; i++)
+            {
+                if (!g[i]->loadState(is))
+                    return false;
+            }
+            return true;
+        }
+
     private:
         unsigned short c,k;
         uint32_t l;
@@ -246,6 +498,27 @@ class ADWunfixed: public HashFunction
         PolK* f;
 
         uint32_t* z;
+
+        void eval_many(const uint32_t* x, uint32_t* out, size_t count, bool second)
+        {
+            const size_t BLOCK = 64;
+            uint32_t gx[BLOCK];
+            for (size_t b = 0; b < count; b += BLOCK)
+            {
+                size_t len = std::min(BLOCK, count - b);
+                if (second)
+                    f->h2_many(x + b, out + b, len);
+                else
+                    f->h1_many(x + b, out + b, len);
+                for (uint32_t i = 0; i < c; i++)
+                {
+                    g[i]->h1_many(x + b, gx, len);
+                    const uint32_t* zi = z + ((second ? c : 0) + i) * size;
+                    for (size_t j = 0; j < len; j++)
+                        out[b + j] += TRACE_READ(zi[gx[j] >> (32 - l)]);
+                }
+            }
+        }
 };
 
 boost::uniform_int<uint32_t> g_dis(0, std::numeric_limits<uint32_t>::max());
@@ -282,7 +555,7 @@ class ADW: public HashFunction
 
     public:
 
-        ADW(unsigned short _c, uint32_t _l)
+        ADW(unsigned short _c, uint32_t _l, bool draw = true)
         {
             c = _c;
             l = _l;
@@ -294,6 +567,13 @@ class ADW: public HashFunction
             boost::uniform_int<uint32_t> dis(0, std::numeric_limits<uint32_t>::max());
             boost::variate_generator<boost::mt19937_64&,boost::uniform_int<uint32_t> > rand (g_gen, dis);
 
+            if (!draw)
+            {
+                std::fill(g, g + c, 1);
+                f1_a = f1_b = f2_a = f2_b = 0;
+                return;
+            }
+
             for (uint32_t i = 0; i < c; i++)
             {
                 // choose odd numbers for c
@@ -305,11 +585,8 @@ class ADW: public HashFunction
                 g[i] = a;
             }
 
-            for (uint32_t i = 0; i < (2 * c * size); i++)
-            {
-                // fill table with random values
-                z[i] = rand();    
-            }
+            // fill table with random values
+            ctrrng::fill(z, 2 * c * size, g_gen(), 0);
 
             f1_a = rand();
             f1_b = rand();
@@ -328,7 +605,7 @@ class ADW: public HashFunction
             uint32_t res = multshift2wise::hash(x, 32, f1_a, f1_b);
             for (uint32_t i = 0; i < c; i++)
             {
-                res += z[i * size + multshift32::hash(x, l, g[i])];
+                res += TRACE_READ(z[i * size + multshift32::hash(x, l, g[i])]);
             }
 
             return (uint32_t) res;
@@ -339,7 +616,7 @@ class ADW: public HashFunction
             uint32_t res = multshift2wise::hash(x, 32, f2_a, f2_b);
             for (uint32_t i = 0; i < c; i++)
             {
-                res += z[ (c + i) * size + multshift32::hash(x, l, g[i])];
+                res += TRACE_READ(z[ (c + i) * size + multshift32::hash(x, l, g[i])]);
             }
 
             return res;
@@ -352,6 +629,30 @@ class ADW: public HashFunction
             return convert.str();
         }
 
+        void getMemoryRegions(std::vector<MemoryRegion>& regions)
+        {
+            regions.push_back(MemoryRegion{ this, sizeof(*this) });
+            regions.push_back(MemoryRegion{ g, c * sizeof(uint32_t) });
+            regions.push_back(MemoryRegion{ z, 2 * c * size * sizeof(uint32_t) });
+        }
+
+        void saveState(std::ostream& os)
+        {
+            uint32_t v[6] = { c, l, f1_a, f1_b, f2_a, f2_b };
+            write_raw(os, v, 6);
+            write_raw(os, g, c);
+            write_raw(os, z, 2 * c * size);
+        }
+
+        bool loadState(std::istream& is)
+        {
+            uint32_t v[6];
+            if (!read_raw(is, v, 6) || v[0] != c || v[1] != l)
+                return false;
+            f1_a = v[2], f1_b = v[3], f2_a = v[4], f2_b = v[5];
+            return read_raw(is, g, c) && read_raw(is, z, 2 * c * size);
+        }
+
     private:
         unsigned short c;
         uint32_t l;
@@ -367,132 +668,133 @@ class ADW: public HashFunction
 
 };
 
-class SimpleTab8: public HashFunction
+// unsigned integer type with the given number of bits
+template <unsigned Bits> struct uint_bits;
+template <> struct uint_bits<16> { typedef uint16_t type; };
+template <> struct uint_bits<32> { typedef uint32_t type; };
+template <> struct uint_bits<64> { typedef uint64_t type; };
+
+// Simple tabulation on CharBits-bit characters of the key, the last one
+// may be shorter. Each character indexes its own table of random entries
+// of EntryBits bits, the hash value of OutBits bits is their xor. With
+// EntryBits < OutBits the tables are compressed and every entry is
+// multiplied into the output width. Two equal entries in a table let the
+// hash ignore the difference of their characters, which is likely for
+// 2^CharBits entries of few bits, so compression suits short characters.
+// h1 and h2 return the low 32 bits, h1_full and h2_full all OutBits bits.
+template <unsigned CharBits, unsigned OutBits = 32, unsigned EntryBits = OutBits>
+class SimpleTab: public HashFunction
 {
     public:
-    SimpleTab8()
-    {
-        z1 = new uint32_t[1<<10];
-        z2 = new uint32_t[1<<10];
-        
-        boost::uniform_int<uint32_t> dis(0, std::numeric_limits<uint32_t>::max());
-        boost::variate_generator<boost::mt19937_64&,boost::uniform_int<uint32_t> > rand (g_gen, dis);
+    typedef typename uint_bits<OutBits>::type Out;
+    typedef typename uint_bits<EntryBits>::type Entry;
 
-        for (uint32_t i = 0; i < 1<<10; i++)
-        {
-            z1[i] = rand();
-        }
-        for (uint32_t i = 0; i < 1<<10; i++)
-        {
-            z2[i] = rand();
-        }
+    static const unsigned CHARS = (32 + CharBits - 1) / CharBits;
+    static const uint32_t ENTRIES = CHARS << CharBits;
+    static const uint32_t MASK = (1U << CharBits) - 1;
+
+    SimpleTab(bool draw = true)
+    {
+        static_assert(CharBits >= 2 && CharBits <= 16, "characters of 2 to 16 bits");
+        static_assert(EntryBits <= OutBits, "entries wider than the output");
+
+        z1 = new Entry[ENTRIES];
+        z2 = new Entry[ENTRIES];
+        if (!draw)
+            return;
+
+        // the words of ctrrng::fill, so SimpleTab<8> and SimpleTab<16>
+        // draw the same tables as the former fixed classes
+        const size_t words = (ENTRIES * sizeof(Entry) + 3) / 4;
+        std::vector<uint32_t> buf(words);
+        uint64_t seed = g_gen();
+        ctrrng::fill(buf.data(), words, seed, 1);
+        memcpy(z1, buf.data(), ENTRIES * sizeof(Entry));
+        ctrrng::fill(buf.data(), words, seed, 2);
+        memcpy(z2, buf.data(), ENTRIES * sizeof(Entry));
     }
 
-    virtual ~SimpleTab8()
+    virtual ~SimpleTab()
     {
         delete[] z1;
         delete[] z2;
     }
 
-    uint32_t h1(uint32_t x)
+    Out h1_full(uint32_t x)
     {
-//        uint32_t res = 0;
-//        for (int i = 0; i < c; i++)
-//        {
-//            res ^= z1[i * 256 + (x & 0xFF)];
-//            x = x >> 8;
-//        }
-//        return res;
-          return z1[x & 0xFF] ^ z1[256 + ((x >> 8) & 0xFF)] ^ z1[512 + ((x >> 16) & 0xFF)]
-                    ^ z1[768 + (x >> 24)];
+        return lookup(z1, x);
     }
-    
-    uint32_t h2(uint32_t x)
+
+    Out h2_full(uint32_t x)
     {
-//        uint32_t res = 0;
-//        for (int i = 0; i < c; i++)
-//        {
-//            res ^= z2[i * 256 + (x & 0xFF)];
-//            x = x >> 8;
-//        }
-//        return res;
-        return z2[x & 0xFF] ^ z2[256 + ((x >> 8) & 0xFF)] ^ z2[512 + ((x >> 16) & 0xFF)]
-                    ^ z2[768 + (x >> 24)];
+        return lookup(z2, x);
     }
-        
-    std::string getDescription()
-        {
-            return "simp-tab-8";
-        }
 
-    private:
-        uint32_t* z1;
-        uint32_t* z2;
-
-};
+    uint32_t h1(uint32_t x)
+    {
+        return (uint32_t) lookup(z1, x);
+    }
 
-class SimpleTab16: public HashFunction
-{
-    public:
-    SimpleTab16()
+    uint32_t h2(uint32_t x)
     {
-        z1 = new uint32_t[1<<17];
-        z2 = new uint32_t[1<<17];
-        
-        boost::uniform_int<uint32_t> dis(0, std::numeric_limits<uint32_t>::max());
-        boost::variate_generator<boost::mt19937_64&,boost::uniform_int<uint32_t> > rand (g_gen, dis);
+        return (uint32_t) lookup(z2, x);
+    }
 
-        for (uint32_t i = 0; i < 1<<17; i++)
-        {
-            z1[i] = rand();
-        }
-        for (uint32_t i = 0; i < 1<<17; i++)
-        {
-            z2[i] = rand();
-        }
+    std::string getDescription()
+    {
+        std::string res = "simp-tab-" + std::to_string(CharBits);
+        if (OutBits != 32)
+            res += "-o" + std::to_string(OutBits);
+        if (EntryBits != OutBits)
+            res += "-e" + std::to_string(EntryBits);
+        return res;
     }
 
-    virtual ~SimpleTab16()
+    void getMemoryRegions(std::vector<MemoryRegion>& regions)
     {
-        delete[] z1;
-        delete[] z2;
+        regions.push_back(MemoryRegion{ this, sizeof(*this) });
+        regions.push_back(MemoryRegion{ z1, ENTRIES * sizeof(Entry) });
+        regions.push_back(MemoryRegion{ z2, ENTRIES * sizeof(Entry) });
     }
 
-    uint32_t h1(uint32_t x)
+    void saveState(std::ostream& os)
     {
-//        uint32_t res = 0;
-//        for (int i = 0; i < c; i++)
-//        {
-//            res ^= z1[i * 256 + (x & 0xFF)];
-//            x = x >> 8;
-//        }
-//        return res;
-          return z1[x & 0xFFFF] ^ z1[(1 << 16) + (x >> 16)];
+        write_raw(os, z1, ENTRIES);
+        write_raw(os, z2, ENTRIES);
     }
-    
-    uint32_t h2(uint32_t x)
+
+    bool loadState(std::istream& is)
     {
-//        uint32_t res = 0;
-//        for (int i = 0; i < c; i++)
-//        {
-//            res ^= z2[i * 256 + (x & 0xFF)];
-//            x = x >> 8;
-//        }
-//        return res;
-          return z2[x & 0xFFFF] ^ z2[(1 << 16) + (x >> 16)];
+        return read_raw(is, z1, ENTRIES) && read_raw(is, z2, ENTRIES);
     }
-        
-    std::string getDescription()
-        {
-            return "simp-tab-16";
-        }
 
     private:
-        uint32_t* z1;
-        uint32_t* z2;
+        Entry* z1;
+        Entry* z2;
+
+        // entry e of character i spread over the output by a fixed odd
+        // multiplier, distinct entries stay distinct
+        static inline Out expand(Entry e, unsigned i)
+        {
+            if (EntryBits == OutBits)
+                return e;
+            return (Out) (e * (0x9E3779B97F4A7C15ULL + 2 * i * 0x632BE59BD9B4E019ULL));
+        }
 
+        inline Out lookup(const Entry* z, uint32_t x)
+        {
+            Out res = 0;
+            for (unsigned i = 0; i < CHARS; i++)
+            {
+                res ^= expand(TRACE_READ(z[(i << CharBits) + ((x >> (i * CharBits)) & MASK)]), i);
+            }
+            return res;
+        }
 };
 
+typedef SimpleTab<8> SimpleTab8;
+typedef SimpleTab<16> SimpleTab16;
+
 
 class Murmur3: public HashFunction
 {
@@ -561,15 +863,13 @@ class Murmur3: public HashFunction
         return h1;
         } 
     public:
-        Murmur3()
+        Murmur3(bool draw = true)
         {
-            boost::mt19937_64 gen;
-            gen.seed(time(NULL));
             boost::uniform_int<uint32_t> dis(0, std::numeric_limits<uint32_t>::max());
-            boost::variate_generator<boost::mt19937_64&,boost::uniform_int<uint32_t> > rand (gen, dis);
+            boost::variate_generator<boost::mt19937_64&,boost::uniform_int<uint32_t> > rand (g_gen, dis);
 
-            h1_seed = rand();
-            h2_seed = rand();
+            h1_seed = draw ? rand() : 0;
+            h2_seed = draw ? rand() : 0;
         }
 
 	virtual ~Murmur3()
@@ -592,4 +892,22 @@ class Murmur3: public HashFunction
             return "Murmur3";
         }
 
+        void getMemoryRegions(std::vector<MemoryRegion>& regions)
+        {
+            regions.push_back(MemoryRegion{ this, sizeof(*this) });
+        }
+
+        void saveState(std::ostream& os)
+        {
+            write_raw(os, &h1_seed);
+            write_raw(os, &h2_seed);
+        }
+
+        bool loadState(std::istream& is)
+        {
+            return read_raw(is, &h1_seed) && read_raw(is, &h2_seed);
+        }
+
 };
+
+#endif // HASHFUNCTIONS_H
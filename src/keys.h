@@ -0,0 +1,172 @@
+#ifndef KEYS_H
+#define KEYS_H
+
+#include <stdint.h>
+#include <cmath>
+#include <vector>
+#include <algorithm>
+
+#include "random.h"
+
+// Key set construction and shuffling. Everything here runs in parallel and
+// is deterministic in the seed, independent of the number of threads.
+
+std::vector<uint32_t> create_hypercube(int l)
+{
+    const int64_t total = (int64_t) l * l * l * l;
+    std::vector<uint32_t> keys(total);
+
+#pragma omp parallel for schedule(static)
+    for (int64_t j = 0; j < total; j++)
+    {
+        uint32_t i4 = j % l;
+        uint32_t i3 = (j / l) % l;
+        uint32_t i2 = (j / l / l) % l;
+        uint32_t i1 = j / l / l / l;
+        keys[j] = (i1 << 24) | (i2 << 16) | (i3 << 8) | i4;
+    }
+    return keys;
+}
+
+std::vector<uint32_t> create_keys(int n)
+{
+    std::vector<uint32_t> keys(n);
+
+#pragma omp parallel for schedule(static)
+    for (int i = 0; i < n; i++)
+    {
+        keys[i] = i + 1;
+    }
+    return keys;
+}
+
+// Uniform random permutation of keys by scattering into buckets.
+//
+// Every element independently draws a bucket from a counter-based RNG, the
+// elements are scattered into their buckets in stable order, and each
+// bucket is then Fisher-Yates shuffled with its own RNG stream. Uniform
+// bucket choice followed by uniform permutation inside the buckets gives a
+// uniform permutation overall. Buckets are sized to stay cache resident.
+void shuffle_keys(std::vector<uint32_t>& keys, uint64_t seed)
+{
+    const uint64_t n = keys.size();
+    const uint64_t bucket_size = 1 << 16;
+    const uint64_t max_buckets = 4096;
+    const uint64_t max_chunks = 256;
+
+    const uint64_t nbuckets = std::min(max_buckets,
+            std::max((uint64_t) 1, n / bucket_size));
+    const uint64_t nchunks = std::min(max_chunks, nbuckets);
+    const uint64_t chunk_size = (n + nchunks - 1) / nchunks;
+
+    // stream 0 chooses buckets, stream 1 + b shuffles bucket b
+    std::vector<uint64_t> hist(nchunks * nbuckets, 0);
+
+#pragma omp parallel for schedule(static)
+    for (uint64_t c = 0; c < nchunks; c++)
+    {
+        uint64_t* hc = &hist[c * nbuckets];
+        uint64_t end = std::min(n, (c + 1) * chunk_size);
+        for (uint64_t i = c * chunk_size; i < end; i++)
+        {
+            hc[ctrrng::bounded(ctrrng::at(seed, 0, i), nbuckets)]++;
+        }
+    }
+
+    // exclusive prefix sum in bucket-major order; remember bucket starts
+    std::vector<uint64_t> bucket_begin(nbuckets + 1);
+    uint64_t sum = 0;
+    for (uint64_t b = 0; b < nbuckets; b++)
+    {
+        bucket_begin[b] = sum;
+        for (uint64_t c = 0; c < nchunks; c++)
+        {
+            uint64_t cnt = hist[c * nbuckets + b];
+            hist[c * nbuckets + b] = sum;
+            sum += cnt;
+        }
+    }
+    bucket_begin[nbuckets] = sum;
+
+    std::vector<uint32_t> out(n);
+
+#pragma omp parallel for schedule(static)
+    for (uint64_t c = 0; c < nchunks; c++)
+    {
+        uint64_t* hc = &hist[c * nbuckets];
+        uint64_t end = std::min(n, (c + 1) * chunk_size);
+        for (uint64_t i = c * chunk_size; i < end; i++)
+        {
+            out[hc[ctrrng::bounded(ctrrng::at(seed, 0, i), nbuckets)]++] = keys[i];
+        }
+    }
+
+#pragma omp parallel for schedule(dynamic)
+    for (uint64_t b = 0; b < nbuckets; b++)
+    {
+        ctrrng::Stream rand(seed, 1 + b);
+        uint32_t* base = &out[bucket_begin[b]];
+        uint64_t size = bucket_begin[b + 1] - bucket_begin[b];
+        for (uint64_t i = size; i > 1; i--)
+        {
+            std::swap(base[i - 1], base[rand.next(i)]);
+        }
+    }
+
+    keys.swap(out);
+}
+
+// count random keys not contained in keys, e.g. negative queries for
+// approximate membership
+std::vector<uint32_t> create_negative_keys(const std::vector<uint32_t>& keys,
+                                           uint64_t count, uint64_t seed)
+{
+    std::vector<uint32_t> sorted(keys);
+    std::sort(sorted.begin(), sorted.end());
+
+    std::vector<uint32_t> neg(count);
+
+#pragma omp parallel for schedule(static)
+    for (uint64_t i = 0; i < count; i++)
+    {
+        ctrrng::Stream rand(seed, i);
+        uint32_t x;
+        do
+        {
+            x = rand.next();
+        }
+        while (x == 0 || std::binary_search(sorted.begin(), sorted.end(), x));
+        neg[i] = x;
+    }
+    return neg;
+}
+
+// length keys from a Zipf distribution with exponent s over the keys
+// 1..universe: the key of rank i (from 1) has probability proportional to
+// i^-s, and the ranks are given to the keys in a random order
+std::vector<uint32_t> create_zipf_stream(uint32_t universe, uint64_t length, double s, uint64_t seed)
+{
+    std::vector<double> cdf(universe);
+    double sum = 0;
+    for (uint32_t i = 0; i < universe; i++)
+    {
+        sum += std::pow(i + 1.0, -s);
+        cdf[i] = sum;
+    }
+
+    std::vector<uint32_t> ranked = create_keys(universe);
+    shuffle_keys(ranked, seed);
+
+    std::vector<uint32_t> stream(length);
+
+#pragma omp parallel for schedule(static)
+    for (uint64_t i = 0; i < length; i++)
+    {
+        double u = (ctrrng::at(~seed, 0, i) >> 11) * 0x1.0p-53 * sum;
+        uint64_t r = std::upper_bound(cdf.begin(), cdf.end(), u) - cdf.begin();
+        stream[i] = ranked[std::min(r, (uint64_t) universe - 1)];
+    }
+    return stream;
+}
+
+#endif // KEYS_H
@@ -0,0 +1,154 @@
+#ifndef LINEARPROBING_H
+#define LINEARPROBING_H
+
+#include <stdint.h>
+#include <vector>
+#include <iostream>
+
+#include "hashfunctions.h"
+
+// Linear probing with deletion by backward shift, so the table never
+// contains tombstones. Uses h1 of the hash function only. As in
+// cuckoohashing, key 0 marks an empty slot.
+namespace linearprobing {
+
+    uint32_t* t;
+
+    uint32_t m;
+
+    HashFunction* h;
+
+    // probe_hist[i]: number of inserts that inspected i+1 slots
+    std::vector<uint64_t> probe_hist;
+
+    void init(uint32_t _m, HashFunction* _h)
+    {
+        h = _h;
+        m = _m;
+
+        t = new uint32_t[m];
+
+        for (uint32_t i = 0; i < m; i++)
+        {
+            t[i] = 0;
+        }
+        probe_hist.clear();
+    }
+
+    void destroy()
+    {
+        delete[] t;
+    }
+
+    void memory_regions(std::vector<MemoryRegion>& regions)
+    {
+        regions.push_back(MemoryRegion{ t, m * sizeof(uint32_t) });
+    }
+
+    bool lookup(uint32_t key)
+    {
+        uint32_t pos = h->h1(key) % m;
+        while (t[pos] != 0)
+        {
+            if (t[pos] == key)
+                return true;
+            if (++pos == m)
+                pos = 0;
+        }
+        return false;
+    }
+
+    void insert(uint32_t key)
+    {
+        uint32_t pos = h->h1(key) % m;
+        uint32_t probes = 1;
+        while (t[pos] != 0 && t[pos] != key)
+        {
+            if (++pos == m)
+                pos = 0;
+            probes++;
+        }
+        t[pos] = key;
+
+        if (probes > probe_hist.size())
+            probe_hist.resize(probes, 0);
+        probe_hist[probes - 1]++;
+    }
+
+    void remove(uint32_t key)
+    {
+        uint32_t i = h->h1(key) % m;
+        while (t[i] != key)
+        {
+            if (t[i] == 0)
+                return;
+            if (++i == m)
+                i = 0;
+        }
+
+        // shift back every following key of the cluster whose home slot
+        // does not lie cyclically in (i, j]
+        uint32_t j = i;
+        while (true)
+        {
+            if (++j == m)
+                j = 0;
+            if (t[j] == 0)
+                break;
+            uint32_t home = h->h1(t[j]) % m;
+            bool stays = (i <= j) ? (i < home && home <= j)
+                                  : (i < home || home <= j);
+            if (!stays)
+            {
+                t[i] = t[j];
+                i = j;
+            }
+        }
+        t[i] = 0;
+    }
+
+    // print probe length statistics of all inserts as key=value pairs;
+    // probe_hist buckets probe lengths in [2^i, 2^(i+1))
+    void print_stats(std::ostream& os)
+    {
+        uint64_t count = 0, sum = 0;
+        for (size_t i = 0; i < probe_hist.size(); i++)
+        {
+            count += probe_hist[i];
+            sum += probe_hist[i] * (i + 1);
+        }
+
+        uint64_t p50 = 0, p99 = 0, seen = 0;
+        for (size_t i = 0; i < probe_hist.size(); i++)
+        {
+            seen += probe_hist[i];
+            if (p50 == 0 && 2 * seen >= count)
+                p50 = i + 1;
+            if (p99 == 0 && 100 * seen >= 99 * count)
+                p99 = i + 1;
+        }
+
+        std::vector<uint64_t> log_hist;
+        for (size_t i = 0; i < probe_hist.size(); i++)
+        {
+            size_t b = 0;
+            while ((size_t(2) << b) <= i + 1)
+                b++;
+            if (b >= log_hist.size())
+                log_hist.resize(b + 1, 0);
+            log_hist[b] += probe_hist[i];
+        }
+
+        os << " probe_avg=" << (count ? (double) sum / count : 0)
+           << " probe_p50=" << p50
+           << " probe_p99=" << p99
+           << " probe_max=" << probe_hist.size()
+           << " probe_hist=";
+        for (size_t b = 0; b < log_hist.size(); b++)
+        {
+            os << (b ? "/" : "") << log_hist[b];
+        }
+    }
+}
+
+#endif // LINEARPROBING_H
@@ -0,0 +1,210 @@
+#ifndef LOCALCUCKOO_H
+#define LOCALCUCKOO_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <vector>
+#include <iostream>
+#include <sys/mman.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "hashfunctions.h"
+#include "random.h"
+
+#ifndef MAXLOOP
+#define MAXLOOP 1000
+#endif
+
+// Cuckoo hashing with both buckets of a key in the same page, so a lookup
+// touches one page and needs at most one TLB entry. The table is an array
+// of pages of page_bytes (4 KB, or 2 MB backed by a transparent huge page
+// where the kernel provides one), each split into buckets of 4 slots. h1
+// selects the page and, by its quotient, the first bucket, h2 the second
+// bucket in the page. Keys are moved by random walk within their page; keys
+// that find no place after MAXLOOP moves go to a stash. With 2 choices a
+// bucket of one slot would overflow the fuller pages, 4 slots keep the load
+// a page can take close to that of the whole table.
+namespace localcuckoo {
+
+    static const uint32_t BUCKET = 4;
+
+    uint32_t* t;
+
+    uint32_t page_bytes;
+    uint32_t page_buckets;
+    uint32_t npages;
+
+    HashFunction* h;
+    ctrrng::Stream* rand;
+    std::vector<uint32_t> stash;
+
+    uint64_t count;
+    // load when the first key went to the stash, 0 if none did
+    double fail_load;
+
+    inline uint64_t slots()
+    {
+        return (uint64_t) npages * page_buckets * BUCKET;
+    }
+
+    // create a table of at least _slots slots in pages of _page_bytes
+    void init(uint64_t _slots, HashFunction* _h, uint32_t _page_bytes)
+    {
+        h = _h;
+        page_bytes = _page_bytes;
+        page_buckets = page_bytes / (BUCKET * sizeof(uint32_t));
+        npages = std::max((uint64_t) 1, (_slots + page_buckets * BUCKET - 1) / (page_buckets * BUCKET));
+
+        size_t bytes = slots() * sizeof(uint32_t);
+        if (posix_memalign((void**) &t, page_bytes, bytes) != 0)
+        {
+            std::cerr << "localcuckoo: cannot allocate " << npages << " pages" << std::endl;
+            abort();
+        }
+#ifdef MADV_HUGEPAGE
+        if (page_bytes >= (2 << 20))
+            madvise(t, bytes, MADV_HUGEPAGE);
+#endif
+        memset(t, 0, bytes);
+
+        rand = new ctrrng::Stream(g_gen(), 0);
+        stash.clear();
+        count = 0;
+        fail_load = 0;
+    }
+
+    void destroy()
+    {
+        free(t);
+        delete rand;
+    }
+
+    void memory_regions(std::vector<MemoryRegion>& regions)
+    {
+        regions.push_back(MemoryRegion{ t, slots() * sizeof(uint32_t) });
+        regions.push_back(MemoryRegion{ stash.data(), stash.capacity() * sizeof(uint32_t) });
+    }
+
+    // the two buckets of key, as indices into the whole table
+    inline void buckets(uint32_t key, uint32_t& b1, uint32_t& b2)
+    {
+        uint32_t hash = h->h1(key);
+        uint32_t page = hash % npages;
+        b1 = page * page_buckets + (hash / npages) % page_buckets;
+        b2 = page * page_buckets + h->h2(key) % page_buckets;
+    }
+
+    inline bool contains(uint32_t b, uint32_t key)
+    {
+#ifdef __SSE2__
+        __m128i v = _mm_load_si128((const __m128i*) &TRACE_READ(t[b * BUCKET]));
+        return _mm_movemask_epi8(_mm_cmpeq_epi32(v, _mm_set1_epi32(key))) != 0;
+#else
+        const uint32_t* s = &TRACE_READ(t[b * BUCKET]);
+        return (s[0] == key) | (s[1] == key) | (s[2] == key) | (s[3] == key);
+#endif
+    }
+
+    inline bool put(uint32_t b, uint32_t key)
+    {
+        uint32_t* s = t + b * BUCKET;
+        for (uint32_t i = 0; i < BUCKET; i++)
+        {
+            if (s[i] == 0)
+            {
+                s[i] = key;
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool lookup(uint32_t key)
+    {
+        TRACE_OPERATION;
+        uint32_t b1, b2;
+        buckets(key, b1, b2);
+        if (contains(b1, key) || contains(b2, key))
+            return true;
+        for (uint32_t i = 0; i < stash.size(); i++)
+        {
+            if (TRACE_READ(stash[i]) == key)
+                return true;
+        }
+        return false;
+    }
+
+    void insert(uint32_t key)
+    {
+        TRACE_OPERATION;
+        count++;
+        uint32_t b1, b2;
+        buckets(key, b1, b2);
+        if (put(b1, key) || put(b2, key))
+            return;
+
+        uint32_t b = rand->next(2) ? b2 : b1;
+        for (uint32_t c = 0; c < MAXLOOP; c++)
+        {
+            uint32_t* s = t + b * BUCKET + rand->next(BUCKET);
+            uint32_t tmp = *s;
+            *s = key;
+            key = tmp;
+
+            // the other bucket of the evicted key, in the same page
+            buckets(key, b1, b2);
+            b = (b == b1) ? b2 : b1;
+            if (put(b, key))
+                return;
+        }
+
+        if (stash.empty())
+            fail_load = (double) count / slots();
+        stash.push_back(key);
+    }
+
+    void remove(uint32_t key)
+    {
+        TRACE_OPERATION;
+        uint32_t b1, b2;
+        buckets(key, b1, b2);
+        for (int j = 0; j < 2; j++)
+        {
+            uint32_t* s = t + (j ? b2 : b1) * BUCKET;
+            for (uint32_t i = 0; i < BUCKET; i++)
+            {
+                if (s[i] == key)
+                {
+                    s[i] = 0;
+                    count--;
+                    return;
+                }
+            }
+        }
+        for (uint32_t i = 0; i < stash.size(); i++)
+        {
+            if (TRACE_READ(stash[i]) == key)
+            {
+                stash.erase(stash.begin() + i);
+                count--;
+                return;
+            }
+        }
+    }
+
+    // load of the table holding n keys
+    void print_stats(std::ostream& os, uint32_t n)
+    {
+        os << " page_bytes=" << page_bytes
+           << " pages=" << npages
+           << " load=" << (double) n / slots()
+           << " fail_load=" << fail_load
+           << " stash_size=" << stash.size();
+    }
+}
+
+#endif // LOCALCUCKOO_H
@@ -1,298 +1,634 @@
 #include<vector>
 #include<cmath>
+#include<string>
+#include <unistd.h>
+#include <x86intrin.h>
 #include <boost/random.hpp>
 
-#define MAXLOOP 1000
-
 static boost::mt19937_64 g_gen;
 
 #include "hashfunctions.h"
 #include "tools/timer.h"
-#include "tools/papi.h"
+#include "tools/counters.h"
+#include "tools/scope.h"
+#include "tools/cache.h"
+#include "tools/stats.h"
+#include "tools/memory.h"
+#include "keys.h"
+#include "methods.h"
+#include "cuckoohashing.h"
+#include "linearprobing.h"
+#include "swisstable.h"
+#include "filters.h"
+#include "shardedcuckoo.h"
+#include "snapshot.h"
+#include "compactcuckoo.h"
+#include "localcuckoo.h"
+#include "mphf.h"
+#include "autotune.h"
 
 //#define DEBUG 0
 
+enum table_t { CUCKOO, LINEAR, SWISS, CUCKOOFILTER, BLOOM, SHARDED, COMPACT, LOCAL, MPHF, NUM_TABLES };
 
-inline size_t rand_int(int bound)
-{
-    boost::uniform_int<size_t> dis(0, bound - 1);
-    return dis(g_gen);
-}
+const char* table_names[NUM_TABLES] = {
+    "cuckoo", "linear", "swiss", "cuckoofilter", "bloom", "sharded", "compact", "local", "mphf"
+};
 
-namespace cuckoohashing {
+// bits set per key in the blocked Bloom filter
+#define BLOOM_K 8
 
-    uint32_t* t1;
-    uint32_t* t2;
+// slots per key of the local table, by default the memory of the cuckoo
+// table; smaller values show the load it reaches (fail_load)
+#ifndef LOCAL_SLOTS_PER_KEY
+#define LOCAL_SLOTS_PER_KEY 2.01
+#endif
 
-    uint32_t m;
+enum cache_mode_t { CACHE_NONE, CACHE_COLD, CACHE_WARM, NUM_CACHE_MODES };
 
-    HashFunction* h;
-    std::vector<uint32_t> stash;
+const char* cache_mode_names[NUM_CACHE_MODES] = { "none", "cold", "warm" };
 
-    void init(uint32_t _m, HashFunction* _h) 
-    {
-        h = _h;
-        m = _m;
+// indexed by cuckoohashing::single_mode_t
+const char* single_mode_names[] = { "none", "split", "fingerprint" };
 
-        t1 = new uint32_t[m];
-        t2 = new uint32_t[m];
+// counters measured in every phase unless -e is given
+#define DEFAULT_EVENTS "PAPI_TOT_INS,PAPI_TOT_CYC,PAPI_L2_TCM,PAPI_L1_TCM"
 
+// added to the default counters of the local table
+#define LOCAL_EVENTS ",PAPI_TLB_DM"
 
-        for (uint32_t i = 0; i < m; i++)
-        {
-            t1[i] = 0;
-            t2[i] = 0;
-        }
+// with -r, repeat at least MIN_REPS trials before stopping early
+#define MIN_REPS 3
+
+// a growing cuckoo table (-g) starts with GROW_START slots per table and
+// doubles when its load would exceed GROW_LOAD
+#define GROW_START 1024
+#define GROW_LOAD 0.45
+
+// output fields that describe the configuration and are not aggregated
+#define PARAM_FIELDS "m,n,seed,h,name,table,cache,threads,shards,bloom_k,slots,grow_step,single,tuned,batch,batch_width,page_bytes,pages"
+
+// count positive answers of a membership structure for queries
+template <bool (*lookup)(uint32_t)>
+uint64_t count_positive(const std::vector<uint32_t>& queries)
+{
+    uint64_t res = 0;
+    for (std::vector<uint32_t>::const_iterator it = queries.begin(); it != queries.end(); it++)
+    {
+        res += lookup(*it);
     }
+    return res;
+}
 
-    bool lookup(uint32_t key)
+// count the queries in the cuckoo table with its batch lookup
+uint64_t count_positive_batched(const std::vector<uint32_t>& queries)
+{
+    std::vector<uint64_t> found((queries.size() + 63) / 64);
+    cuckoohashing::lookup_many(queries.data(), queries.size(), found.data());
+    uint64_t res = 0;
+    for (size_t i = 0; i < found.size(); i++)
     {
-        if (t1[h->h1(key) % m] == key)
-            return true;
-        if (t2[h->h2(key) % m] == key)
-            return true;
-        for (uint32_t i = 0; i < stash.size(); i++)
-	{
-            if (stash[i] == key)
-	    {
-                return true;
-	    }
-        }
-	return false;
+        res += __builtin_popcountll(found[i]);
     }
+    return res;
+}
+
+// the shuffled key set of a trial, n keys or the hypercube [32]^4 if n is 0
+std::vector<uint32_t> create_key_set(uint32_t n, uint32_t seed)
+{
+    std::vector<uint32_t> keys = (n > 0) ? create_keys(n) : create_hypercube(32);
+    shuffle_keys(keys, seed);
+    return keys;
+}
 
-    void remove(uint32_t key)
+// append the memory held by table
+void table_memory_regions(int table, std::vector<MemoryRegion>& regions)
+{
+    switch (table)
     {
-        if (t1[h->h1(key) % m] == key)
-            t1[h->h1(key) % m] = 0;
-        if (t2[h->h2(key) % m] == key)
-            t2[h->h2(key) % m] = 0;
-        for (uint32_t i = 0; i < stash.size(); i++)
-            if (stash[i] == key)
-                stash.erase(stash.begin() + i); 
+        case CUCKOO:
+            cuckoohashing::memory_regions(regions);
+            break;
+        case LINEAR:
+            linearprobing::memory_regions(regions);
+            break;
+        case SWISS:
+            swisstable::memory_regions(regions);
+            break;
+        case CUCKOOFILTER:
+            cuckoofilter::memory_regions(regions);
+            break;
+        case BLOOM:
+            bloomfilter::memory_regions(regions);
+            break;
+        case SHARDED:
+            shardedcuckoo::memory_regions(regions);
+            break;
+        case COMPACT:
+            compactcuckoo::memory_regions(regions);
+            break;
+        case LOCAL:
+            localcuckoo::memory_regions(regions);
+            break;
+        case MPHF:
+            mphf::memory_regions(regions);
+            break;
     }
+}
 
-    void insert(uint64_t key)
+// total size of a list of memory regions
+size_t region_bytes(const std::vector<MemoryRegion>& regions)
+{
+    size_t res = 0;
+    for (size_t i = 0; i < regions.size(); i++)
     {
-        uint64_t tmp = 0;
-        uint64_t hash = 0;
-        uint8_t i = 1;
-        uint16_t c = 0;
-#ifdef DEBUG            
-        std::cout <<
-            "Key: " << key << 
-            " h1: " << h->h1(key) % m << 
-            " h2: " << h->h2(key) % m <<
-            std::endl;
-#endif
+        res += regions[i].bytes;
+    }
+    return res;
+}
 
-        while (c < MAXLOOP)
-        {
-                
-            if (i == 1)
-            {
-                hash = h->h1(key) % m;
-                tmp = t1[hash];
-                t1[hash] = key;
-            }
-            else
-            {
-                hash = h->h2(key) % m;
-                tmp = t2[hash];
-                t2[hash] = key;
-            }
-            key = tmp;
-            if (key == 0)
-                break;
-            c++;
-            i = 3 - i;
-        }
-        if (key != 0)
+// bytes allocated for the stash of the cuckoo tables, 0 for other tables
+size_t table_stash_bytes(int table)
+{
+    switch (table)
+    {
+        case CUCKOO:
+            return cuckoohashing::stash.capacity() * sizeof(uint32_t);
+        case SHARDED:
         {
-            stash.push_back(key);
+            size_t res = 0;
+            for (size_t s = 0; s < shardedcuckoo::shards.size(); s++)
+                res += shardedcuckoo::shards[s].stash.capacity() * sizeof(uint32_t);
+            return res;
         }
+        case COMPACT:
+            return compactcuckoo::stash.capacity() * sizeof(uint32_t);
+        case LOCAL:
+            return localcuckoo::stash.capacity() * sizeof(uint32_t);
+        case MPHF:
+            return mphf::stash.capacity() * sizeof(uint32_t);
     }
+    return 0;
 }
 
-std::vector<uint32_t> create_hypercube(int l)
+// Bring the hash function state and the table into a defined cache state
+// before a measured phase: cold flushes them from all caches with clflush,
+// warm evaluates both hash functions on all keys and reads the table.
+void prepare_cache(int mode, int table, HashFunction* h, const std::vector<uint32_t>& keys)
 {
-    std::vector<uint32_t> keys;
+#ifdef WITH_CACHE_SIM
+    if (mode == CACHE_COLD)
+        cache_simulator().flush();
+#endif
 
-    for (int i1 = 0; i1 < l; i1++)
+    if (mode == CACHE_NONE)
+        return;
+
+    std::vector<MemoryRegion> regions;
+    h->getMemoryRegions(regions);
+    table_memory_regions(table, regions);
+
+    if (mode == CACHE_WARM)
     {
-        for (int i2 = 0; i2 < l; i2++)
+        uint32_t acc = 0;
+        for (std::vector<uint32_t>::const_iterator it = keys.begin(); it != keys.end(); it++)
         {
-            for (int i3 = 0; i3 < l; i3++)
-            {
-                for (int i4 = 0; i4 < l; i4++)
-                {
-                    keys.push_back((i1 << 24) | (i2 << 16) | (i3 << 8) | i4);                
-                }
-            }
+            acc ^= h->h1(*it) ^ h->h2(*it);
         }
+        escape(acc);
     }
-    return keys;
-}
 
-std::vector<uint32_t> create_keys(int n)
-{
-    std::vector<uint32_t> keys;
-    keys.reserve(n);
-    for (int i = 1; i < n + 1; i++)
+    for (size_t i = 0; i < regions.size(); i++)
     {
-        keys.push_back(i);
+        if (mode == CACHE_COLD)
+            flush_region(regions[i].ptr, regions[i].bytes);
+        else
+            touch_region(regions[i].ptr, regions[i].bytes);
     }
-    return keys;
 }
 
-int main(int argc, char** argv)
+// settings shared by all trials of a configuration
+struct Config
 {
-    if (argc < 3 || argc > 4)
-    {
-        std::cout << "Usage: seed method [n]" << std::endl;
-	std::cout << "If [n] is not given, input will be the hypercube [32]^4" << std::endl;
-	std::cout << "Available Methods: \n" 
-		  << "\t 0 - simple tabulation 8-bit char \n" 
-		  << "\t 1 - simple tabulation 16-bit char \n" 
-		  << "\t 2 - Murmur3\n" 
-		  << "\t 3 - degree 3 polynomial \n" 
-		  << "\t 4 - degree 20 polynomial \n" 
-		  << "\t 5 - Z, 3 tables with sqrt(n) entries\n" 
-		  << "\t 6 - Z, 4 tables with n^{1/4} entries\n" 
-		  << "\t 7 - Z, 8 tables with sqrt(n) entries\n" 
-		  << "\t 8 - Z, 16 tables with n^{1/4} entries\n" 
-		  << "\t 9 - Z, 1 table, 6-wise independence, with sqrt(n) entries\n" 
-		  << "\t 10 - Z, 1 table, 12-wise independence, with n^{1/4} entries\n" 
-		  << "\t 11 - Z, 1 table, 16-wise independence, with sqrt(n) entries\n" 
-		  << "\t 12 - fully random, just returns random hash values. Warning: Does not store the key-value mapping!\n" << std::endl;
-        return 0;
-    }
+    int table;
+    int method;
+    int cache_mode;
+    bool extended;
+    uint32_t shard_bits;
+    // number of keys, 0 for the hypercube [32]^4
+    uint32_t n;
+    // cuckoo table snapshot to start from and to write after the inserts
+    std::string snapshot_in, snapshot_out;
+    // hash function parameters to use and to write after construction
+    std::string hash_in, hash_out;
+    // grow the cuckoo table from GROW_START slots, migrating grow_step slot
+    // pairs per insert
+    bool grow;
+    uint32_t grow_step;
+    // look up the cuckoo table with lookup_many
+    bool batch_lookup;
+    // cuckoohashing::single_mode_t, both slots from one evaluation of h1
+    int single;
+    // method, single and batch_lookup were chosen by autotune
+    bool tuned;
+    // page size of the local table
+    uint32_t page_bytes;
+};
+
+// Run one trial of a configuration: create and shuffle the keys, draw the
+// hash function and measure all phases of the table. The result is written
+// to out as key=value pairs without line end. Returns false if the trial
+// failed: no hash function, or a snapshot or parameter file that could not
+// be read or written.
+bool run_trial(const Config& cfg, uint32_t seed, CounterWrapper& papi, std::ostream& out)
+{
+    const int table = cfg.table;
+    const int method = cfg.method;
+    const int cache_mode = cfg.cache_mode;
+    const bool extended = cfg.extended;
+    const uint32_t shard_bits = cfg.shard_bits;
 
-    uint32_t seed = atoi(argv[1]);
-    int method = atoi(argv[2]);
     std::vector<uint32_t> keys;
     HashFunction* h;
     uint32_t n, m;
     
     g_gen.seed(seed);
 
+    ScopeResults scopes;
+
+    // filters are queried with n keys that are not in the set
+    std::vector<uint32_t> negatives;
 
-    if (argc == 4)
-    {
-        keys = create_keys(atoi(argv[3]));
-    }
-    else
     {
-        keys = create_hypercube(32);
+        MeasureScope scope("keygen", papi, scopes);
+
+        keys = create_key_set(cfg.n, seed);
+
+        if (table == CUCKOOFILTER || table == BLOOM)
+        {
+            negatives = create_negative_keys(keys, keys.size(), ~(uint64_t) seed);
+        }
     }
-    
-    std::random_shuffle(keys.begin(), keys.end(), rand_int);
+
     n = keys.size();
     m = 1.005 * n;
 
-    int l1 = (int) ceil(log2(std::sqrt(n)));
-    int l2 = (int) ceil(log2(std::pow(n, 0.25)));
+    MeasureScope construction("construction", papi, scopes);
+
+    h = cfg.snapshot_in.empty() ? create_hash_function(method, n, cfg.hash_in.empty())
+                                : snapshot::load(cfg.snapshot_in, method, n);
+    if (h == NULL)
+    {
+        if (cfg.snapshot_in.empty())
+            std::cerr << " Method not supported " << std::endl;
+        return false;
+    }
+    if (!cfg.hash_in.empty() && !import_hash_function(cfg.hash_in, method, n, h))
+    {
+        delete h;
+        return false;
+    }
+    bool valid = true;
+    if (!cfg.hash_out.empty())
+        valid = export_hash_function(cfg.hash_out, method, n, h);
+    
 
-    switch (method)
+    switch (table)
     {
-        case 0:
-            h = new SimpleTab8();
+        case CUCKOO:
+            if (cfg.snapshot_in.empty())
+                cuckoohashing::init(cfg.grow ? GROW_START : m, h);
             break;
-        case 1:
-            h = new SimpleTab16();
+        case LINEAR:
+            linearprobing::init(2 * m, h);
             break;
-        case 2:
-            h = new Murmur3();
+        case SWISS:
+            swisstable::init(2 * m, h);
             break;
-        case 3:
-            h =  new PolK(3);
+        case CUCKOOFILTER:
+            cuckoofilter::init(n, h);
             break;
-        case 4:
-            h = new PolK(20);
+        case BLOOM:
+            bloomfilter::init(16 * (uint64_t) n, BLOOM_K, h);
             break;
-        case 5:
-            // fail prob. 1/n^{1/2}
-            h = new ADW(3, l1);
+        case SHARDED:
+        case MPHF:
+            // bulk built from the keys in the insert phase
             break;
-        case 6:
-            //fail prob. 1/n^{1/3}
-            h = new ADW(4, l2);
+        case COMPACT:
+            compactcuckoo::init(m, h);
             break;
-        case 7:
-            //fail prob. 1/n^{3}
-            h = new ADW(8, l1);
+        case LOCAL:
+            localcuckoo::init(LOCAL_SLOTS_PER_KEY * n, h, cfg.page_bytes);
             break;
-        case 8:
-            // fail prob 1/n^3
-            h = new ADW(16, l2);
+    }
+
+    construction.stop();
+
+    prepare_cache(cache_mode, table, h, keys);
+
+    // cycles of every insert into a growing table, split by whether a
+    // resize was running
+    std::vector<uint64_t> latency, migration_latency;
+    if (cfg.grow)
+    {
+        latency.reserve(n);
+        migration_latency.reserve(n);
+    }
+
+    MeasureScope insert("insert", papi, scopes);
+    switch (table)
+    {
+        case CUCKOO:
+            // a loaded snapshot holds all keys already
+            if (!cfg.snapshot_in.empty())
+                break;
+            if (cfg.grow)
+            {
+                // resizes and migration steps are measured as phase
+                // migration, the insert phase holds the inserts alone; the
+                // latency of an insert includes its migration step, and an
+                // insert that starts a resize counts as migrating
+                MeasureScope migration("migration", papi, scopes, false);
+                for (std::vector<uint32_t>::iterator it = keys.begin() ; it != keys.end(); it++)
+                {
+                    bool migrating = false;
+                    uint64_t cycles = 0;
+                    if (cuckoohashing::grow_pending(GROW_LOAD))
+                    {
+                        insert.pause();
+                        migration.resume();
+                        uint64_t start = __rdtsc();
+                        migrating = cuckoohashing::grow(GROW_LOAD, cfg.grow_step);
+                        cycles = __rdtsc() - start;
+                        migration.pause();
+                        insert.resume();
+                    }
+                    uint64_t start = __rdtsc();
+                    cuckoohashing::insert_counted(*it);
+                    cycles += __rdtsc() - start;
+                    (migrating ? migration_latency : latency).push_back(cycles);
+                }
+                break;
+            }
+            if (cfg.single == cuckoohashing::SPLIT)
+            {
+                for (std::vector<uint32_t>::iterator it = keys.begin() ; it != keys.end(); it++)
+                {
+                    cuckoohashing::insert_single<cuckoohashing::SPLIT>(*it);
+                }
+                break;
+            }
+            if (cfg.single == cuckoohashing::FINGERPRINT)
+            {
+                for (std::vector<uint32_t>::iterator it = keys.begin() ; it != keys.end(); it++)
+                {
+                    cuckoohashing::insert_single<cuckoohashing::FINGERPRINT>(*it);
+                }
+                break;
+            }
+            for (std::vector<uint32_t>::iterator it = keys.begin() ; it != keys.end(); it++)
+            {
+                cuckoohashing::insert(*it);
+            }
             break;
-        case 9:
-            // fail prob 1/n^{1/3}
-            h = new ADWunfixed(6, 1, l1);
+        case LINEAR:
+            for (std::vector<uint32_t>::iterator it = keys.begin() ; it != keys.end(); it++)
+            {
+                linearprobing::insert(*it);
+            }
             break;
-        case 10:
-            // fail prob 1/n^{1/3}
-            h = new ADWunfixed(12, 1, l2);
+        case SWISS:
+            for (std::vector<uint32_t>::iterator it = keys.begin() ; it != keys.end(); it++)
+            {
+                swisstable::insert(*it, *it);
+            }
             break;
-        case 11:
-            // fail prob 1/n^3
-            h = new ADWunfixed(16, 1, l1);
+        case CUCKOOFILTER:
+            for (std::vector<uint32_t>::iterator it = keys.begin() ; it != keys.end(); it++)
+            {
+                cuckoofilter::insert(*it);
+            }
             break;
-        case 12:
-            h = new FullyRandom();
+        case BLOOM:
+            for (std::vector<uint32_t>::iterator it = keys.begin() ; it != keys.end(); it++)
+            {
+                bloomfilter::insert(*it);
+            }
+            break;
+        case SHARDED:
+            shardedcuckoo::build(keys, shard_bits, h);
+            break;
+        case MPHF:
+            mphf::build(keys, shard_bits, h);
+            break;
+        case COMPACT:
+            for (std::vector<uint32_t>::iterator it = keys.begin() ; it != keys.end(); it++)
+            {
+                compactcuckoo::insert(*it);
+            }
+            break;
+        case LOCAL:
+            for (std::vector<uint32_t>::iterator it = keys.begin() ; it != keys.end(); it++)
+            {
+                localcuckoo::insert(*it);
+            }
             break;
-        default:
-            std::cerr << " Method not supported " << std::endl;
-            return 0;
     }
-    
-
-    cuckoohashing::init(m, h);
-    
-    ClockIntervalBase<CLOCK_MONOTONIC> timer;
-    ClockIntervalBase<CLOCK_PROCESS_CPUTIME_ID> cpu_timer;
-    PApiWrapper papi;
-
-    papi.add_event(PAPI_TOT_INS); // Total Instructions
-    papi.add_event(PAPI_TOT_CYC); // Total Cycles
+    insert.stop();
 
-    papi.add_event(PAPI_L2_TCM); // L2 Total Cache Misses
-    papi.add_event(PAPI_L1_TCM); // L2 Total Cache Misses
+    if (!cfg.snapshot_out.empty())
+    {
+        MeasureScope scope("snapshot", papi, scopes);
+        valid = snapshot::save(cfg.snapshot_out, method, n) && valid;
+    }
 
-    //papi.add_event(PAPI_BR_CN); // Conditional branch instructions executed
-    //papi.add_event(PAPI_BR_TKN); // Conditional branch instructions taken
-    //papi.add_event(PAPI_BR_NTK); // Conditional branch instructions not taken
-    //papi.add_event(PAPI_BR_MSP); // Conditional branch instructions mispred
-    //papi.add_event(PAPI_BR_PRC); // Conditional branch instructions correctly predicted
-    
+    // lookup phase: always for filters (n negative, then n positive
+    // queries) and the bulk builds, for the tables with -L
+    uint64_t false_pos = 0, true_pos = 0;
 
-    
+    if (table == CUCKOOFILTER || table == BLOOM || table == SHARDED || table == MPHF || extended ||
+        !cfg.snapshot_in.empty())
+    {
+        prepare_cache(cache_mode, table, h, keys);
 
+        MeasureScope scope("lookup", papi, scopes);
+        switch (table)
+        {
+            case CUCKOO:
+                if (cfg.single == cuckoohashing::SPLIT)
+                    true_pos = count_positive<cuckoohashing::lookup_single<cuckoohashing::SPLIT> >(keys);
+                else if (cfg.single == cuckoohashing::FINGERPRINT)
+                    true_pos = count_positive<cuckoohashing::lookup_single<cuckoohashing::FINGERPRINT> >(keys);
+                else
+                    true_pos = cfg.batch_lookup ? count_positive_batched(keys)
+                                                : count_positive<cuckoohashing::lookup>(keys);
+                break;
+            case LINEAR:
+                true_pos = count_positive<linearprobing::lookup>(keys);
+                break;
+            case SWISS:
+                true_pos = count_positive<swisstable::lookup>(keys);
+                break;
+            case CUCKOOFILTER:
+                false_pos = count_positive<cuckoofilter::lookup>(negatives);
+                true_pos = count_positive<cuckoofilter::lookup>(keys);
+                break;
+            case BLOOM:
+                false_pos = count_positive<bloomfilter::lookup>(negatives);
+                true_pos = count_positive<bloomfilter::lookup>(keys);
+                break;
+            case SHARDED:
+                true_pos = count_positive<shardedcuckoo::lookup>(keys);
+                break;
+            case COMPACT:
+                true_pos = count_positive<compactcuckoo::lookup>(keys);
+                break;
+            case LOCAL:
+                true_pos = count_positive<localcuckoo::lookup>(keys);
+                break;
+            case MPHF:
+                true_pos = count_positive<mphf::lookup>(keys);
+                break;
+        }
+    }
 
-    papi.start(), cpu_timer.start(), timer.start();
-    for (std::vector<uint32_t>::iterator it = keys.begin() ; it != keys.end(); it++)
+    // remove phase: delete all keys again, tables with -L only
+    if (extended && (table == CUCKOO || table == LINEAR || table == SWISS || table == COMPACT ||
+        table == LOCAL))
     {
-        cuckoohashing::insert(*it);
+        prepare_cache(cache_mode, table, h, keys);
+
+        MeasureScope scope("remove", papi, scopes);
+        for (std::vector<uint32_t>::iterator it = keys.begin() ; it != keys.end(); it++)
+        {
+            switch (table)
+            {
+                case CUCKOO:
+                    if (cfg.single == cuckoohashing::SPLIT)
+                        cuckoohashing::remove_single<cuckoohashing::SPLIT>(*it);
+                    else if (cfg.single == cuckoohashing::FINGERPRINT)
+                        cuckoohashing::remove_single<cuckoohashing::FINGERPRINT>(*it);
+                    else
+                        cuckoohashing::remove(*it);
+                    break;
+                case LINEAR:
+                    linearprobing::remove(*it);
+                    break;
+                case SWISS:
+                    swisstable::remove(*it);
+                    break;
+                case COMPACT:
+                    compactcuckoo::remove(*it);
+                    break;
+                case LOCAL:
+                    localcuckoo::remove(*it);
+                    break;
+            }
+        }
     }
-    timer.stop(), cpu_timer.stop(), papi.stop();
 
-    std::cout <<
+    const ScopeResult& ins = *scopes.find("insert");
+
+    out <<
                 " m=" << m <<
                 " n=" << n <<
                 " seed=" << seed <<
                 " h=" << method << 
                 " name=" << h->getDescription() << 
-                " time=" << timer.delta() <<
-                " cpu_time=" << cpu_timer.delta() <<
-                " stash_size=" << cuckoohashing::stash.size();
+                " table=" << table_names[table] <<
+                " cache=" << cache_mode_names[cache_mode] <<
+                " time=" << ins.time <<
+                " cpu_time=" << ins.cpu_time;
+
+    switch (table)
+    {
+        case CUCKOO:
+            out << " single=" << single_mode_names[cfg.single]
+                << " stash_size=" << cuckoohashing::stash.size();
+            if (cfg.tuned)
+                out << " tuned=1 batch=" << cfg.batch_lookup;
+            if (cfg.batch_lookup)
+                out << " batch_width=" << cuckoohashing::batch_width();
+            if (cfg.grow)
+            {
+                out << " grow_step=" << cfg.grow_step
+                    << " final_m=" << cuckoohashing::m
+                    << " resizes=" << cuckoohashing::resizes
+                    << " max_migration_step=" << cuckoohashing::max_migration_step
+                    << " migrating_inserts=" << migration_latency.size();
+                print_percentiles(out, "insert_cycles_", latency);
+                print_percentiles(out, "migration_insert_cycles_", migration_latency);
+            }
+            break;
+        case LINEAR:
+            linearprobing::print_stats(out);
+            break;
+        case SWISS:
+            swisstable::print_stats(out, n);
+            break;
+        case CUCKOOFILTER:
+        case BLOOM:
+            out <<
+                " fpr=" << (double) false_pos / negatives.size() <<
+                " false_negatives=" << n - true_pos <<
+                " bits_per_key=" << (double) (table == BLOOM ?
+                        bloomfilter::size_in_bits() : cuckoofilter::size_in_bits()) / n;
+            if (table == BLOOM)
+                bloomfilter::print_stats(out);
+            else
+                cuckoofilter::print_stats(out);
+            break;
+        case SHARDED:
+            out <<
+                " threads=" << omp_get_max_threads() <<
+                " shards=" << (1 << shard_bits) <<
+                " throughput=" << n / ins.time <<
+                " not_found=" << n - true_pos <<
+                " stash_size=" << shardedcuckoo::stash_size();
+            break;
+        case MPHF:
+            out <<
+                " threads=" << omp_get_max_threads() <<
+                " shards=" << mphf::shards.size() <<
+                " throughput=" << n / ins.time <<
+                " not_found=" << n - true_pos;
+            mphf::print_stats(out, n);
+            break;
+        case COMPACT:
+            compactcuckoo::print_stats(out, n);
+            break;
+        case LOCAL:
+            localcuckoo::print_stats(out, n);
+            break;
+    }
     
     
-    for (size_t i = 0 ; i < papi.get_num_counter(); ++i)
+    std::vector<MemoryRegion> hash_regions, table_regions;
+    h->getMemoryRegions(hash_regions);
+    table_memory_regions(table, table_regions);
+    size_t hash_bytes = region_bytes(hash_regions);
+    size_t stash_bytes = table_stash_bytes(table);
+
+    out <<
+        " hash_bytes=" << hash_bytes <<
+        " table_bytes=" << region_bytes(table_regions) - stash_bytes <<
+        " stash_bytes=" << stash_bytes <<
+        " peak_rss=" << peak_rss_bytes();
+    if (l2_cache_bytes() > 0)
+        out << " hash_l2_share=" << (double) hash_bytes / l2_cache_bytes();
+
+    if ((extended && (table == CUCKOO || table == LINEAR || table == SWISS || table == COMPACT ||
+        table == LOCAL)) ||
+        !cfg.snapshot_in.empty())
+        out << " not_found=" << n - true_pos;
+
+    for (size_t i = 0 ; i < ins.counters.size(); ++i)
     {
-        std::cout << " " << papi.get_counter_name(i) << "=" << papi.get_counter_result(i);
+        out << " " << ins.counters[i].first << "=" << ins.counters[i].second;
     }
 
-    std::cout << std::endl;
+    scopes.print(out);
 
 //    for (std::vector<uint32_t>::iterator it = keys.begin() ; it != keys.end(); it++)
 //    {
@@ -302,37 +638,284 @@ int main(int argc, char** argv)
 //            break;
 //        }
 //    }
-    switch (method)
+    delete h;
+    switch (table)
     {
-        case 0:
-            delete (SimpleTab8*) h;
+        case CUCKOO:
+            cuckoohashing::destroy();
+            snapshot::unmap();
+            break;
+        case LINEAR:
+            linearprobing::destroy();
             break;
-        case 1:
-            delete (SimpleTab16*) h;
+        case SWISS:
+            swisstable::destroy();
             break;
-        case 2:
-            delete (Murmur3*)h;
+        case CUCKOOFILTER:
+            cuckoofilter::destroy();
             break;
-        case 3:
-            delete (PolK*)h;
+        case BLOOM:
+            bloomfilter::destroy();
             break;
-        case 4:
-            delete (PolK*) h;
+        case SHARDED:
+            shardedcuckoo::destroy();
             break;
-        case 5:
-        case 6:
-        case 7:
-        case 8:
-            delete (ADW*) h;
+        case COMPACT:
+            compactcuckoo::destroy();
             break;
-        case 9:
-        case 10:
-        case 11:
-            delete (ADWunfixed*) h;
+        case LOCAL:
+            localcuckoo::destroy();
             break;
+        case MPHF:
+            mphf::destroy();
+            break;
+    }
+    return valid;
+}
+
+int main(int argc, char** argv)
+{
+    int table = CUCKOO;
+    uint32_t shard_bits = 8;
+    std::string events = DEFAULT_EVENTS;
+    bool extended = false;
+    int cache_mode = CACHE_NONE;
+    uint32_t reps = 1;
+    std::string snapshot_in, snapshot_out;
+    std::string hash_in, hash_out;
+    double target = 0.01;
+    int grow_step = -1;
+    bool batch_lookup = false;
+    int single = cuckoohashing::TWO_FUNCTIONS;
+    std::string tune_file;
+    bool events_given = false;
+    uint32_t page_kb = 4;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "t:p:s:e:LC:r:a:G:W:R:X:I:g:BS:A:P:")) != -1)
+    {
+        switch (opt)
+        {
+            case 't':
+                for (table = 0; table < NUM_TABLES; table++)
+                    if (table_names[table] == std::string(optarg))
+                        break;
+                break;
+            case 'p':
+                omp_set_num_threads(atoi(optarg));
+                break;
+            case 's':
+                shard_bits = std::max(0, std::min(16, atoi(optarg)));
+                break;
+            case 'e':
+                events = optarg;
+                events_given = true;
+                break;
+            case 'L':
+                extended = true;
+                break;
+            case 'C':
+                for (cache_mode = 0; cache_mode < NUM_CACHE_MODES; cache_mode++)
+                    if (cache_mode_names[cache_mode] == std::string(optarg))
+                        break;
+                break;
+            case 'r':
+                reps = std::max(1, atoi(optarg));
+                break;
+            case 'a':
+                target = atof(optarg);
+                break;
+            case 'G':
+                cache_simulator().configure(optarg);
+                break;
+            case 'W':
+                snapshot_out = optarg;
+                break;
+            case 'R':
+                snapshot_in = optarg;
+                break;
+            case 'X':
+                hash_out = optarg;
+                break;
+            case 'I':
+                hash_in = optarg;
+                break;
+            case 'g':
+                grow_step = std::max(0, atoi(optarg));
+                break;
+            case 'B':
+                batch_lookup = true;
+                break;
+            case 'S':
+                for (single = 0; single <= cuckoohashing::FINGERPRINT; single++)
+                    if (single_mode_names[single] == std::string(optarg))
+                        break;
+                break;
+            case 'A':
+                tune_file = optarg;
+                break;
+            case 'P':
+                page_kb = atoi(optarg);
+                break;
+            default:
+                return 0;
+        }
+    }
+    argv += optind - 1;
+    argc -= optind - 1;
+
+    const bool tune = (argc >= 3 && argv[2] == std::string("auto"));
+
+    if (argc < 3 || argc > 4 || table == NUM_TABLES || cache_mode == NUM_CACHE_MODES ||
+        (!tune && (atoi(argv[2]) < 0 || atoi(argv[2]) >= NUM_METHODS)) ||
+        (tune && (table != CUCKOO || single != cuckoohashing::TWO_FUNCTIONS || batch_lookup ||
+            grow_step >= 0 || !snapshot_in.empty() || !hash_in.empty())) ||
+        (!tune && !tune_file.empty()) ||
+        page_kb < 1 || page_kb > (1 << 20) || (page_kb & (page_kb - 1)) != 0 ||
+        (table != CUCKOO && !(snapshot_in.empty() && snapshot_out.empty())) ||
+        !(snapshot_in.empty() || hash_in.empty()) ||
+        (grow_step >= 0 && (table != CUCKOO || !snapshot_in.empty())) ||
+        (single != cuckoohashing::TWO_FUNCTIONS && (table != CUCKOO || single > cuckoohashing::FINGERPRINT ||
+            grow_step >= 0 || batch_lookup || !(snapshot_in.empty() && snapshot_out.empty()))))
+    {
+        std::cout << "Usage: [-t table] [-p threads] [-s shard_bits] [-e events] [-L] [-C cache] [-r reps] [-a target] [-G geometry] [-W file] [-R file] [-X file] [-I file] [-g step] [-B] [-S mode] [-A file] [-P page_kb] seed method [n]" << std::endl;
+	std::cout << "If [n] is not given, input will be the hypercube [32]^4" << std::endl;
+	std::cout << "-e takes a comma separated list of PAPI presets measured in every phase,\n"
+		  << "   e.g. TOT_CYC,BR_MSP,TLB_DM (default " DEFAULT_EVENTS ")\n"
+		  << "-L adds lookup and remove phases of all keys\n"
+		  << "-C cold flushes hash function state and table from the caches before every\n"
+		  << "   measured phase, -C warm runs the hash functions over all keys and reads\n"
+		  << "   the table first (default none)\n"
+		  << "-r repeats the trial up to reps times with seeds seed, seed+1, ... and prints\n"
+		  << "   mean, median, stddev, 95% confidence interval and minimum of every value;\n"
+		  << "   stops after at least " << MIN_REPS << " valid trials once the confidence interval of\n"
+		  << "   the insert time is within target times its mean (-a, default 0.01);\n"
+		  << "   failed trials are not included and counted as failed_reps\n"
+		  << "-G sets the simulated caches of a build with WITH_CACHE_SIM as comma separated\n"
+		  << "   list of size_in_KB:ways from L1 to the LLC (default 32:8,1024:16,32768:16)\n"
+		  << "-W writes a snapshot of the cuckoo table and hash function after the inserts,\n"
+		  << "   -R maps such a snapshot instead of inserting and looks up all keys\n"
+		  << "-X writes the parameters of the hash function to a file, -I uses the parameters\n"
+		  << "   from such a file instead of the ones drawn from the seed\n"
+		  << "-g grows the cuckoo table from " << GROW_START << " slots by doubling at load " << GROW_LOAD << ", moving\n"
+		  << "   step slot pairs of the old tables per insert (0: all at once), at least\n"
+		  << "   enough to finish before the next resize, and reports insert latency\n"
+		  << "   percentiles in cycles during and outside of migrations\n"
+		  << "-B looks up the cuckoo table in batches with SIMD gathers (AVX-512 or AVX2)\n"
+		  << "   and reports the keys per batch as batch_width, 1 without SIMD\n"
+		  << "-S split takes both cuckoo slots from one evaluation of h1, -S fingerprint the\n"
+		  << "   first slot from h1 and the second from it and the high 16 bits of h1\n"
+		  << "method auto measures all methods on a sample of the keys for the cuckoo table,\n"
+		  << "   rejects those with skewed bucket loads or a stash at full load and runs\n"
+		  << "   the fastest one with its fastest slot mode (-S) and lookup (-B); -A keeps\n"
+		  << "   the choice in a file and reuses it for the same n. The function drawn\n"
+		  << "   from seed is validated; with -r, later trials draw their own functions\n"
+		  << "   and only method, slot mode and lookup carry over\n"
+		  << "-P sets the page of the local table in KB, a power of two (default 4, 2048\n"
+		  << "   for huge pages); the local table also measures\n"
+		  << "   PAPI_TLB_DM (dTLB misses) unless -e is given\n" << std::endl;
+	std::cout << "Available Tables: \n"
+		  << "\t cuckoo - cuckoo hashing, two tables with m slots each (default)\n"
+		  << "\t linear - linear probing with backward shift deletion, 2m slots\n"
+		  << "\t swiss - SSE2 probing of 16-slot groups with 7-bit tags, at least 2m slots\n"
+		  << "\t cuckoofilter - cuckoo filter, 16-bit fingerprints in 4-slot buckets at 95% load\n"
+		  << "\t bloom - Bloom filter blocked in cache lines, 16 bits per key\n"
+		  << "\t sharded - parallel bulk build of 2^shard_bits cuckoo tables (default 2^8)\n"
+		  << "\t compact - cuckoo hashing storing only quotients of Feistel permuted keys\n"
+		  << "\t local - cuckoo hashing with both 4-slot buckets of a key in one page, 2m slots\n"
+		  << "\t mphf - static table, keys placed densely by a minimal perfect hash function\n"
+		  << "\t        built in parallel over 2^shard_bits shards\n" << std::endl;
+	std::cout << "Available Methods: \n";
+	print_methods(std::cout);
+        return 0;
+    }
+
+    uint32_t seed = atoi(argv[1]);
+
+    Config cfg;
+    cfg.table = table;
+    cfg.method = tune ? 0 : atoi(argv[2]);
+    cfg.cache_mode = cache_mode;
+    cfg.extended = extended;
+    cfg.shard_bits = shard_bits;
+    cfg.n = (argc == 4) ? atoi(argv[3]) : 0;
+    cfg.snapshot_in = snapshot_in;
+    cfg.snapshot_out = snapshot_out;
+    cfg.hash_in = hash_in;
+    cfg.hash_out = hash_out;
+    cfg.grow = (grow_step >= 0);
+    cfg.grow_step = cfg.grow ? grow_step : 0;
+    cfg.batch_lookup = batch_lookup;
+    cfg.single = single;
+    cfg.tuned = tune;
+    cfg.page_bytes = page_kb << 10;
+
+    if (tune)
+    {
+        autotune::Candidate choice;
+        if (tune_file.empty() || !autotune::load(tune_file, cfg.n, choice))
+        {
+            std::vector<uint32_t> keys = create_key_set(cfg.n, seed);
+            // draw the candidates from the state the first trial starts from
+            g_gen.seed(seed);
+            std::vector<autotune::Candidate> candidates = autotune::run(keys, 1.005 * keys.size());
+            for (size_t i = 0; i < candidates.size(); i++)
+            {
+                const autotune::Candidate& c = candidates[i];
+                std::cerr << " autotune h=" << c.method << " name=" << c.name
+                          << " single=" << single_mode_names[c.single]
+                          << " batch=" << c.batch_lookup << " skew=" << c.skew << " stash=" << c.stash << " validated=" << c.validated
+                          << " rejected=" << c.rejected << " insert_ns=" << c.insert_ns
+                          << " lookup_ns=" << c.lookup_ns << std::endl;
+            }
+            if (!autotune::best(candidates, choice))
+            {
+                std::cerr << "autotune: all methods rejected" << std::endl;
+                return 1;
+            }
+            if (!tune_file.empty())
+                autotune::save(tune_file, cfg.n, choice);
+        }
+        cfg.method = choice.method;
+        cfg.single = choice.single;
+        cfg.batch_lookup = choice.batch_lookup;
+    }
+
+    if (table == LOCAL && !events_given)
+        events += LOCAL_EVENTS;
+
+    CounterWrapper papi;
+    papi.add_event_list(events);
+
+    if (reps == 1)
+    {
+        bool valid = run_trial(cfg, seed, papi, std::cout);
+        std::cout << std::endl;
+        return valid ? 0 : 1;
+    }
+
+    // failed trials are left out of the statistics and only counted
+    TrialStats stats(PARAM_FIELDS);
+    uint32_t failed = 0;
+    for (uint32_t r = 0; r < reps; r++)
+    {
+        std::ostringstream line;
+        if (!run_trial(cfg, seed + r, papi, line))
+        {
+            failed++;
+            continue;
+        }
+        stats.add(line.str());
+        if (stats.trials() >= MIN_REPS && stats.relative_ci95("time") <= target)
+            break;
+    }
+    if (stats.trials() == 0)
+    {
+        std::cerr << "all " << failed << " trials failed" << std::endl;
+        return 1;
     }
-    delete[] cuckoohashing::t1;
-    delete[] cuckoohashing::t2;
+    stats.print(std::cout);
+    std::cout << " failed_reps=" << failed << std::endl;
 
     return 0;
 }
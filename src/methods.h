@@ -0,0 +1,134 @@
+#ifndef METHODS_H
+#define METHODS_H
+
+#include <stdint.h>
+#include <cmath>
+#include <iostream>
+#include <fstream>
+#include <string>
+
+#include "hashfunctions.h"
+
+// The hash function constructions selected by the method number on the
+// command line. The table sizes of the ADW constructions depend on the
+// number of keys n.
+
+#define NUM_METHODS 15
+
+// create hash function number method for n keys, NULL if there is none;
+// with draw = false its parameters are left for loadState
+HashFunction* create_hash_function(int method, uint32_t n, bool draw = true)
+{
+    int l1 = (int) ceil(log2(std::sqrt(n)));
+    int l2 = (int) ceil(log2(std::pow(n, 0.25)));
+
+    switch (method)
+    {
+        case 0:
+            return new SimpleTab8(draw);
+        case 1:
+            return new SimpleTab16(draw);
+        case 2:
+            return new Murmur3(draw);
+        case 3:
+            return new PolK(3, draw);
+        case 4:
+            return new PolK(20, draw);
+        case 5:
+            // fail prob. 1/n^{1/2}
+            return new ADW(3, l1, draw);
+        case 6:
+            //fail prob. 1/n^{1/3}
+            return new ADW(4, l2, draw);
+        case 7:
+            //fail prob. 1/n^{3}
+            return new ADW(8, l1, draw);
+        case 8:
+            // fail prob 1/n^3
+            return new ADW(16, l2, draw);
+        case 9:
+            // fail prob 1/n^{1/3}
+            return new ADWunfixed(6, 1, l1, draw);
+        case 10:
+            // fail prob 1/n^{1/3}
+            return new ADWunfixed(12, 1, l2, draw);
+        case 11:
+            // fail prob 1/n^3
+            return new ADWunfixed(16, 1, l1, draw);
+        case 12:
+            return new FullyRandom();
+        case 13:
+            return new SimpleTab<11>(draw);
+        case 14:
+            // 16-bit entries, 12 KB instead of 24 KB per table
+            return new SimpleTab<11, 32, 16>(draw);
+        default:
+            return NULL;
+    }
+}
+
+// Parameter files of hash functions: one text line
+//   hashfunction <version> <method> <n> <description>
+// followed by the binary state written by saveState.
+#define HASH_FILE_VERSION 1
+
+// write the parameters of hash function h, created as method for n keys
+bool export_hash_function(const std::string& path, int method, uint32_t n, HashFunction* h)
+{
+    std::ofstream os(path.c_str(), std::ios::binary);
+    os << "hashfunction " << HASH_FILE_VERSION << " " << method << " " << n << " "
+       << h->getDescription() << "\n";
+    h->saveState(os);
+    if (!os)
+    {
+        std::cerr << "cannot write hash function to " << path << std::endl;
+        return false;
+    }
+    return true;
+}
+
+// replace the parameters of h, created as method for n keys, with those in
+// path; false if the file holds a different construction
+bool import_hash_function(const std::string& path, int method, uint32_t n, HashFunction* h)
+{
+    std::ifstream is(path.c_str(), std::ios::binary);
+    std::string magic, name;
+    int version = 0, file_method = -1;
+    uint32_t file_n = 0;
+    is >> magic >> version >> file_method >> file_n >> name;
+    is.get();
+
+    if (!is || magic != "hashfunction" || version != HASH_FILE_VERSION)
+    {
+        std::cerr << "cannot read hash function from " << path << std::endl;
+        return false;
+    }
+    if (file_method != method || file_n != n || name != h->getDescription() || !h->loadState(is))
+    {
+        std::cerr << path << " holds " << name << " for n=" << file_n
+                  << ", not " << h->getDescription() << " for n=" << n << std::endl;
+        return false;
+    }
+    return true;
+}
+
+void print_methods(std::ostream& os)
+{
+    os << "\t 0 - simple tabulation 8-bit char \n" 
+       << "\t 1 - simple tabulation 16-bit char \n" 
+       << "\t 2 - Murmur3\n" 
+       << "\t 3 - degree 3 polynomial \n" 
+       << "\t 4 - degree 20 polynomial \n" 
+       << "\t 5 - Z, 3 tables with sqrt(n) entries\n" 
+       << "\t 6 - Z, 4 tables with n^{1/4} entries\n" 
+       << "\t 7 - Z, 8 tables with sqrt(n) entries\n" 
+       << "\t 8 - Z, 16 tables with n^{1/4} entries\n" 
+       << "\t 9 - Z, 1 table, 6-wise independence, with sqrt(n) entries\n" 
+       << "\t 10 - Z, 1 table, 12-wise independence, with n^{1/4} entries\n" 
+       << "\t 11 - Z, 1 table, 16-wise independence, with sqrt(n) entries\n" 
+       << "\t 12 - fully random, just returns random hash values. Warning: Does not store the key-value mapping!\n"
+       << "\t 13 - simple tabulation 11-bit char \n"
+       << "\t 14 - simple tabulation 11-bit char, 16-bit entries \n" << std::endl;
+}
+
+#endif // METHODS_H
@@ -0,0 +1,357 @@
+#ifndef MPHF_H
+#define MPHF_H
+
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+#include <iostream>
+
+#include "hashfunctions.h"
+#include "random.h"
+
+// vertices per key of the hypergraph, and the increase after every salt
+// that failed
+#ifndef MPHF_GAMMA
+#define MPHF_GAMMA 1.23
+#endif
+
+#ifndef MPHF_GAMMA_STEP
+#define MPHF_GAMMA_STEP 0.03
+#endif
+
+// keys per shard at least on average, fewer shards than 2^shard_bits are
+// used for small key sets
+#ifndef MPHF_MIN_SHARD
+#define MPHF_MIN_SHARD 4096
+#endif
+
+// salts tried per shard before its keys go to the stash
+#ifndef MPHF_MAX_TRIES
+#define MPHF_MAX_TRIES 16
+#endif
+
+// words of g between two rank samples
+#define MPHF_RANK_WORDS 8
+
+// Static table built once from a key set: a minimal perfect hash function
+// (BDZ) maps the n keys to 0..n-1 and the keys are stored in that order in
+// a dense array without empty slots. As in shardedcuckoo, the high bits of
+// h1 select one of 2^shard_bits shards, which are built in parallel. Within
+// a shard of k keys, a key is an edge of a 3-hypergraph on 3 parts of r =
+// gamma * k / 3 + 8 vertices, taken from a salted mix of h1 and h2, so
+// every salt draws an independent hypergraph.
+// The hypergraph is peeled by repeatedly removing an edge with a vertex of
+// degree 1; in reverse order, every edge sets the 2-bit value g of that
+// vertex so that the g values of its vertices sum to its index modulo 3.
+// Vertices never set keep g = 3, the key goes to the rank of its vertex
+// among those with g != 3. If the hypergraph has a 2-core the next salt is
+// tried with MPHF_GAMMA_STEP more vertices per key, and after
+// MPHF_MAX_TRIES the keys of the shard are stashed.
+namespace mphf {
+
+    struct Shard {
+        // vertices per part
+        uint32_t r;
+        uint64_t salt;
+        // first key of the shard in keys
+        uint32_t offset;
+        // 2-bit values g, 32 per word
+        std::vector<uint64_t> g;
+        // vertices with g != 3 before every MPHF_RANK_WORDS words
+        std::vector<uint32_t> rank;
+        // salts tried
+        uint32_t tries;
+        // false if no salt worked and the keys are stashed
+        bool built;
+    };
+
+    std::vector<Shard> shards;
+    std::vector<uint32_t> keys;
+    std::vector<uint32_t> stash;
+
+    uint32_t shard_bits;
+
+    HashFunction* h;
+
+    inline uint32_t shard_of(uint32_t hash)
+    {
+        return shard_bits ? hash >> (32 - shard_bits) : 0;
+    }
+
+    // map 32 random bits to [0, r) without a division
+    inline uint32_t reduce(uint32_t x, uint32_t r)
+    {
+        return ((uint64_t) x * r) >> 32;
+    }
+
+    // the vertices of a key with hash values h1 and h2, vertex i in part i
+    inline void vertices(const Shard& s, uint32_t h1, uint32_t h2, uint32_t* v)
+    {
+        uint64_t a = ctrrng::mix64((((uint64_t) h1 << 32) | h2) ^ s.salt);
+        uint64_t b = ctrrng::mix64(a);
+        v[0] = reduce(a >> 32, s.r);
+        v[1] = s.r + reduce(a, s.r);
+        v[2] = 2 * s.r + reduce(b >> 32, s.r);
+    }
+
+    inline uint32_t get_g(const Shard& s, uint32_t v)
+    {
+        return (s.g[v / 32] >> (2 * (v % 32))) & 3;
+    }
+
+    // vertices with g != 3 among the 32 of word w
+    inline uint32_t assigned(uint64_t w)
+    {
+        return 32 - __builtin_popcountll(w & (w >> 1) & 0x5555555555555555ULL);
+    }
+
+    // the position of a key in its shard
+    inline uint32_t position(const Shard& s, uint32_t h1, uint32_t h2)
+    {
+        uint32_t v[3];
+        vertices(s, h1, h2, v);
+        uint32_t x = v[(get_g(s, v[0]) + get_g(s, v[1]) + get_g(s, v[2])) % 3];
+
+        uint32_t w = x / 32;
+        uint32_t res = s.rank[w / MPHF_RANK_WORDS];
+        for (uint32_t i = w - w % MPHF_RANK_WORDS; i < w; i++)
+            res += assigned(s.g[i]);
+        // vertices of word w before x, those after are masked to g = 3
+        uint64_t before = s.g[w] | (~0ULL << (2 * (x % 32)));
+        return res + assigned(before);
+    }
+
+    // build the function of shard s for its k hash value pairs, false if
+    // the hypergraph has a 2-core
+    bool build_shard(Shard& s, const uint32_t* h1, const uint32_t* h2, uint32_t k)
+    {
+        const uint32_t nv = 3 * s.r;
+        std::vector<uint32_t> edges(3 * (size_t) k);
+        std::vector<uint32_t> degree(nv, 0);
+        // xor of the incident edges, the edge itself at degree 1
+        std::vector<uint32_t> incident(nv, 0);
+
+        for (uint32_t e = 0; e < k; e++)
+        {
+            vertices(s, h1[e], h2[e], &edges[3 * e]);
+            for (int i = 0; i < 3; i++)
+            {
+                degree[edges[3 * e + i]]++;
+                incident[edges[3 * e + i]] ^= e;
+            }
+        }
+
+        // peel, order[j] holds edge and position of its free vertex
+        std::vector<uint64_t> order;
+        order.reserve(k);
+        std::vector<uint32_t> queue;
+        for (uint32_t v = 0; v < nv; v++)
+        {
+            if (degree[v] == 1)
+                queue.push_back(v);
+        }
+        while (!queue.empty())
+        {
+            uint32_t v = queue.back();
+            queue.pop_back();
+            if (degree[v] != 1)
+                continue;
+            uint32_t e = incident[v];
+            for (int i = 0; i < 3; i++)
+            {
+                uint32_t u = edges[3 * e + i];
+                if (u == v)
+                    order.push_back(((uint64_t) e << 2) | i);
+                degree[u]--;
+                incident[u] ^= e;
+                if (degree[u] == 1)
+                    queue.push_back(u);
+            }
+        }
+        if (order.size() != k)
+            return false;
+
+        s.g.assign((nv + 31) / 32, ~0ULL);
+        for (size_t j = order.size(); j-- > 0; )
+        {
+            uint32_t e = order[j] >> 2;
+            uint32_t i = order[j] & 3;
+            const uint32_t* v = &edges[3 * e];
+            // g = 3 of unset vertices counts as 0
+            uint32_t sum = get_g(s, v[0]) + get_g(s, v[1]) + get_g(s, v[2]) - get_g(s, v[i]);
+            uint32_t value = (i + 6 - sum % 3) % 3;
+            s.g[v[i] / 32] &= ~(3ULL << (2 * (v[i] % 32)));
+            s.g[v[i] / 32] |= (uint64_t) value << (2 * (v[i] % 32));
+        }
+
+        s.rank.assign((s.g.size() + MPHF_RANK_WORDS - 1) / MPHF_RANK_WORDS, 0);
+        uint32_t count = 0;
+        for (size_t w = 0; w < s.g.size(); w++)
+        {
+            if (w % MPHF_RANK_WORDS == 0)
+                s.rank[w / MPHF_RANK_WORDS] = count;
+            count += assigned(s.g[w]);
+        }
+        return true;
+    }
+
+    void build(const std::vector<uint32_t>& _keys, uint32_t _shard_bits, HashFunction* _h)
+    {
+        h = _h;
+        const uint64_t n = _keys.size();
+        shard_bits = _shard_bits;
+        while (shard_bits > 0 && (n >> shard_bits) < MPHF_MIN_SHARD)
+            shard_bits--;
+
+        const uint32_t nshards = 1 << shard_bits;
+        const uint64_t nchunks = std::max((uint64_t) 1, std::min((uint64_t) 256, n >> 16));
+        const uint64_t chunk_size = (n + nchunks - 1) / nchunks;
+        const uint64_t seed = g_gen();
+
+        // hash all keys and partition them by shard, counting sort over
+        // fixed chunks
+        std::vector<uint32_t> h1(n), h2(n);
+        std::vector<uint64_t> count(nchunks * nshards, 0);
+
+#pragma omp parallel for schedule(static)
+        for (uint64_t c = 0; c < nchunks; c++)
+        {
+            uint64_t* cc = &count[c * nshards];
+            uint64_t end = std::min(n, (c + 1) * chunk_size);
+            for (uint64_t i = c * chunk_size; i < end; i++)
+            {
+                h1[i] = h->h1(_keys[i]);
+                h2[i] = h->h2(_keys[i]);
+                cc[shard_of(h1[i])]++;
+            }
+        }
+
+        std::vector<uint64_t> shard_begin(nshards + 1);
+        uint64_t sum = 0;
+        for (uint32_t s = 0; s < nshards; s++)
+        {
+            shard_begin[s] = sum;
+            for (uint64_t c = 0; c < nchunks; c++)
+            {
+                uint64_t cnt = count[c * nshards + s];
+                count[c * nshards + s] = sum;
+                sum += cnt;
+            }
+        }
+        shard_begin[nshards] = sum;
+
+        std::vector<uint32_t> part(n), part_h1(n), part_h2(n);
+
+#pragma omp parallel for schedule(static)
+        for (uint64_t c = 0; c < nchunks; c++)
+        {
+            uint64_t* cc = &count[c * nshards];
+            uint64_t end = std::min(n, (c + 1) * chunk_size);
+            for (uint64_t i = c * chunk_size; i < end; i++)
+            {
+                uint64_t j = cc[shard_of(h1[i])]++;
+                part[j] = _keys[i];
+                part_h1[j] = h1[i];
+                part_h2[j] = h2[i];
+            }
+        }
+
+        shards.resize(nshards);
+        // one more for position 0 of an empty last shard
+        keys.assign(n + 1, 0);
+        stash.clear();
+
+#pragma omp parallel for schedule(dynamic)
+        for (uint32_t s = 0; s < nshards; s++)
+        {
+            Shard& sh = shards[s];
+            const uint64_t b = shard_begin[s];
+            const uint32_t k = shard_begin[s + 1] - b;
+            sh.offset = b;
+
+            sh.tries = 0;
+            sh.built = false;
+            while (!sh.built && sh.tries < MPHF_MAX_TRIES)
+            {
+                // a few extra vertices for small shards
+                sh.r = (MPHF_GAMMA + MPHF_GAMMA_STEP * sh.tries) * k / 3 + 8;
+                sh.salt = ctrrng::at(seed, s, ++sh.tries);
+                sh.built = build_shard(sh, &part_h1[b], &part_h2[b], k);
+            }
+
+            if (!sh.built)
+            {
+                // nothing is found through g, all keys go to the stash
+                sh.g.assign((3 * sh.r + 31) / 32, ~0ULL);
+                sh.rank.assign((sh.g.size() + MPHF_RANK_WORDS - 1) / MPHF_RANK_WORDS, 0);
+#pragma omp critical
+                stash.insert(stash.end(), &part[b], &part[b] + k);
+                continue;
+            }
+            for (uint64_t i = b; i < b + k; i++)
+            {
+                keys[b + position(sh, part_h1[i], part_h2[i])] = part[i];
+            }
+        }
+    }
+
+    void destroy()
+    {
+        shards.clear();
+        std::vector<uint32_t>().swap(keys);
+        std::vector<uint32_t>().swap(stash);
+    }
+
+    void memory_regions(std::vector<MemoryRegion>& regions)
+    {
+        regions.push_back(MemoryRegion{ shards.data(), shards.capacity() * sizeof(Shard) });
+        regions.push_back(MemoryRegion{ keys.data(), keys.capacity() * sizeof(uint32_t) });
+        for (size_t s = 0; s < shards.size(); s++)
+        {
+            regions.push_back(MemoryRegion{ shards[s].g.data(), shards[s].g.capacity() * sizeof(uint64_t) });
+            regions.push_back(MemoryRegion{ shards[s].rank.data(), shards[s].rank.capacity() * sizeof(uint32_t) });
+        }
+        regions.push_back(MemoryRegion{ stash.data(), stash.capacity() * sizeof(uint32_t) });
+    }
+
+    bool lookup(uint32_t key)
+    {
+        TRACE_OPERATION;
+        uint32_t hash = h->h1(key);
+        const Shard& s = shards[shard_of(hash)];
+        if (TRACE_READ(keys[s.offset + position(s, hash, h->h2(key))]) == key)
+            return true;
+        for (uint32_t i = 0; i < stash.size(); i++)
+        {
+            if (TRACE_READ(stash[i]) == key)
+                return true;
+        }
+        return false;
+    }
+
+    // bits of g and the rank samples
+    uint64_t function_bits()
+    {
+        uint64_t res = 0;
+        for (size_t s = 0; s < shards.size(); s++)
+            res += 64 * shards[s].g.size() + 32 * shards[s].rank.size();
+        return res;
+    }
+
+    void print_stats(std::ostream& os, uint32_t n)
+    {
+        uint32_t tries = 0, failed = 0;
+        for (size_t s = 0; s < shards.size(); s++)
+        {
+            tries = std::max(tries, shards[s].tries);
+            failed += !shards[s].built;
+        }
+        os << " mphf_bits_per_key=" << (n ? (double) function_bits() / n : 0)
+           << " bits_per_key=" << (n ? (double) (function_bits() + 32 * (uint64_t) n) / n : 0)
+           << " max_tries=" << tries
+           << " failed_shards=" << failed
+           << " stash_size=" << stash.size();
+    }
+}
+
+#endif // MPHF_H
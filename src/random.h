@@ -0,0 +1,68 @@
+#ifndef RANDOM_H
+#define RANDOM_H
+
+#include <stdint.h>
+
+// Counter-based random numbers: the i-th value of stream s under a seed is
+// a pure function of (seed, s, i), so blocks of work can draw their random
+// values independently and in parallel while the result only depends on
+// the seed.
+namespace ctrrng {
+
+    // splitmix64 finalizer, a bijection on 64-bit words
+    inline uint64_t mix64(uint64_t z)
+    {
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+        return z ^ (z >> 31);
+    }
+
+    // i-th random word of stream s
+    inline uint64_t at(uint64_t seed, uint64_t s, uint64_t i)
+    {
+        return mix64(mix64(seed ^ mix64(s + 0x9e3779b97f4a7c15ULL))
+                + i * 0x9e3779b97f4a7c15ULL);
+    }
+
+    // map a random word to [0, bound)
+    inline uint64_t bounded(uint64_t r, uint64_t bound)
+    {
+        return (uint64_t) (((unsigned __int128) r * bound) >> 64);
+    }
+
+    // fill words with the first count values of stream s, the high halves
+    // of what Stream(seed, s).next() returns; the loop vectorizes
+    inline void fill(uint32_t* words, uint64_t count, uint64_t seed, uint64_t s)
+    {
+        const uint64_t base = mix64(seed ^ mix64(s + 0x9e3779b97f4a7c15ULL));
+        for (uint64_t i = 0; i < count; i++)
+        {
+            words[i] = (uint32_t) (mix64(base + i * 0x9e3779b97f4a7c15ULL) >> 32);
+        }
+    }
+
+    // sequential generator walking along one stream
+    class Stream {
+        public:
+            Stream(uint64_t seed, uint64_t s)
+                : base(mix64(seed ^ mix64(s + 0x9e3779b97f4a7c15ULL))), i(0)
+            {
+            }
+
+            uint64_t next()
+            {
+                return mix64(base + (i++) * 0x9e3779b97f4a7c15ULL);
+            }
+
+            uint64_t next(uint64_t bound)
+            {
+                return bounded(next(), bound);
+            }
+
+        private:
+            uint64_t base;
+            uint64_t i;
+    };
+}
+
+#endif // RANDOM_H
@@ -0,0 +1,194 @@
+#ifndef SHARDEDCUCKOO_H
+#define SHARDEDCUCKOO_H
+
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+
+#include "hashfunctions.h"
+
+#ifndef MAXLOOP
+#define MAXLOOP 1000
+#endif
+
+// Bulk build of a cuckoo hash table split into 2^shard_bits independent
+// shards. The high bits of h1 select the shard, each shard is a cuckoo
+// table with two tables of 1.005 times its number of keys and its own
+// stash. Keys are partitioned in parallel and the shards are built on
+// separate threads without any locking.
+namespace shardedcuckoo {
+
+    struct Shard {
+        uint32_t* t1;
+        uint32_t* t2;
+        uint32_t m;
+        std::vector<uint32_t> stash;
+    };
+
+    std::vector<Shard> shards;
+
+    uint32_t shard_bits;
+
+    HashFunction* h;
+
+    inline uint32_t shard_of(uint32_t hash)
+    {
+        return shard_bits ? hash >> (32 - shard_bits) : 0;
+    }
+
+    void insert(Shard& s, uint32_t key)
+    {
+        uint32_t tmp = 0;
+        uint32_t hash = 0;
+        uint8_t i = 1;
+        uint16_t c = 0;
+
+        while (c < MAXLOOP)
+        {
+            if (i == 1)
+            {
+                hash = h->h1(key) % s.m;
+                tmp = s.t1[hash];
+                s.t1[hash] = key;
+            }
+            else
+            {
+                hash = h->h2(key) % s.m;
+                tmp = s.t2[hash];
+                s.t2[hash] = key;
+            }
+            key = tmp;
+            if (key == 0)
+                break;
+            c++;
+            i = 3 - i;
+        }
+        if (key != 0)
+        {
+            s.stash.push_back(key);
+        }
+    }
+
+    void build(const std::vector<uint32_t>& keys, uint32_t _shard_bits, HashFunction* _h)
+    {
+        h = _h;
+        shard_bits = _shard_bits;
+
+        const uint64_t n = keys.size();
+        const uint32_t nshards = 1 << shard_bits;
+        const uint64_t nchunks = std::max((uint64_t) 1, std::min((uint64_t) 256, n >> 16));
+        const uint64_t chunk_size = (n + nchunks - 1) / nchunks;
+
+        // partition keys by shard, counting sort over fixed chunks
+        std::vector<uint16_t> sid(n);
+        std::vector<uint64_t> count(nchunks * nshards, 0);
+
+#pragma omp parallel for schedule(static)
+        for (uint64_t c = 0; c < nchunks; c++)
+        {
+            uint64_t* cc = &count[c * nshards];
+            uint64_t end = std::min(n, (c + 1) * chunk_size);
+            for (uint64_t i = c * chunk_size; i < end; i++)
+            {
+                sid[i] = shard_of(h->h1(keys[i]));
+                cc[sid[i]]++;
+            }
+        }
+
+        std::vector<uint64_t> shard_begin(nshards + 1);
+        uint64_t sum = 0;
+        for (uint32_t s = 0; s < nshards; s++)
+        {
+            shard_begin[s] = sum;
+            for (uint64_t c = 0; c < nchunks; c++)
+            {
+                uint64_t cnt = count[c * nshards + s];
+                count[c * nshards + s] = sum;
+                sum += cnt;
+            }
+        }
+        shard_begin[nshards] = sum;
+
+        std::vector<uint32_t> part(n);
+
+#pragma omp parallel for schedule(static)
+        for (uint64_t c = 0; c < nchunks; c++)
+        {
+            uint64_t* cc = &count[c * nshards];
+            uint64_t end = std::min(n, (c + 1) * chunk_size);
+            for (uint64_t i = c * chunk_size; i < end; i++)
+            {
+                part[cc[sid[i]]++] = keys[i];
+            }
+        }
+
+        // build every shard on one thread, tables are first touched there
+        shards.resize(nshards);
+
+#pragma omp parallel for schedule(dynamic)
+        for (uint32_t s = 0; s < nshards; s++)
+        {
+            Shard& sh = shards[s];
+            sh.m = 1.005 * (shard_begin[s + 1] - shard_begin[s]) + 1;
+            sh.t1 = new uint32_t[sh.m];
+            sh.t2 = new uint32_t[sh.m];
+            for (uint32_t i = 0; i < sh.m; i++)
+            {
+                sh.t1[i] = 0;
+                sh.t2[i] = 0;
+            }
+            for (uint64_t i = shard_begin[s]; i < shard_begin[s + 1]; i++)
+            {
+                insert(sh, part[i]);
+            }
+        }
+    }
+
+    void destroy()
+    {
+        for (size_t s = 0; s < shards.size(); s++)
+        {
+            delete[] shards[s].t1;
+            delete[] shards[s].t2;
+        }
+        shards.clear();
+    }
+
+    void memory_regions(std::vector<MemoryRegion>& regions)
+    {
+        regions.push_back(MemoryRegion{ shards.data(), shards.capacity() * sizeof(Shard) });
+        for (size_t s = 0; s < shards.size(); s++)
+        {
+            regions.push_back(MemoryRegion{ shards[s].t1, shards[s].m * sizeof(uint32_t) });
+            regions.push_back(MemoryRegion{ shards[s].t2, shards[s].m * sizeof(uint32_t) });
+            regions.push_back(MemoryRegion{ shards[s].stash.data(),
+                                            shards[s].stash.capacity() * sizeof(uint32_t) });
+        }
+    }
+
+    bool lookup(uint32_t key)
+    {
+        uint32_t hash = h->h1(key);
+        const Shard& s = shards[shard_of(hash)];
+        if (s.t1[hash % s.m] == key)
+            return true;
+        if (s.t2[h->h2(key) % s.m] == key)
+            return true;
+        for (uint32_t i = 0; i < s.stash.size(); i++)
+        {
+            if (s.stash[i] == key)
+                return true;
+        }
+        return false;
+    }
+
+    size_t stash_size()
+    {
+        size_t res = 0;
+        for (size_t s = 0; s < shards.size(); s++)
+            res += shards[s].stash.size();
+        return res;
+    }
+}
+
+#endif // SHARDEDCUCKOO_H
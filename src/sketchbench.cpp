@@ -0,0 +1,224 @@
+#include<vector>
+#include<cmath>
+#include<string>
+#include <unistd.h>
+#include <boost/random.hpp>
+
+static boost::mt19937_64 g_gen;
+
+#include "hashfunctions.h"
+#include "tools/timer.h"
+#include "keys.h"
+#include "methods.h"
+#include "sketches.h"
+
+// Benchmark of the hash functions in count-min and count sketches over a
+// Zipf stream. Every method draws d functions, one per row, updates the
+// sketch with all keys of the stream and estimates the count of every key
+// of the universe, which is compared against the exact counts:
+//  - err_bound is e/w * N for count-min and sqrt(3/w) * |f|_2 for the
+//    count sketch, over_bound the share of the keys of the stream whose
+//    error exceeds it,
+//  - keys with at least phi * N occurrences are heavy hitters (hh), hh_recall
+//    is the share of them estimated at least phi * N, hh_false the number of
+//    other keys estimated at least phi * N.
+// With several threads, each thread updates its own sketch from a part of
+// the stream and the sketches are merged at the end, within the timing.
+
+static const char* kind_names[] = { "count-min", "count-sketch" };
+
+void bench(int method, int kind, uint32_t seed, uint32_t d, uint32_t w, uint32_t batch, double zipf,
+           double phi, const std::vector<uint32_t>& stream, const std::vector<uint32_t>& exact)
+{
+    const uint32_t universe = exact.size() - 1;
+    const uint64_t N = stream.size();
+
+    g_gen.seed(seed);
+    std::vector<HashFunction*> rows(d);
+    size_t hash_bytes = 0;
+    for (uint32_t i = 0; i < d; i++)
+    {
+        rows[i] = create_hash_function(method, universe);
+        std::vector<MemoryRegion> regions;
+        rows[i]->getMemoryRegions(regions);
+        for (size_t j = 0; j < regions.size(); j++)
+            hash_bytes += regions[j].bytes;
+    }
+
+    const int threads = omp_get_max_threads();
+    std::vector<sketch::Sketch> local(threads);
+
+    ClockIntervalBase<CLOCK_MONOTONIC> timer;
+    timer.start();
+
+#pragma omp parallel
+    {
+        int t = omp_get_thread_num();
+        uint64_t begin = N * t / threads, end = N * (t + 1) / threads;
+        sketch::init(local[t], kind, d, w);
+        sketch::update(local[t], rows, &stream[begin], end - begin, batch);
+    }
+    sketch::Sketch& s = local[0];
+    for (int t = 1; t < threads; t++)
+    {
+        sketch::merge(s, local[t]);
+    }
+
+    timer.stop();
+    double time = timer.delta();
+
+    std::vector<int64_t> est(universe + 1);
+    timer.start();
+    for (uint32_t x = 1; x <= universe; x++)
+    {
+        est[x] = sketch::estimate(s, rows, x);
+    }
+    timer.stop();
+    double query_time = timer.delta();
+
+    double l2 = 0;
+    for (uint32_t x = 1; x <= universe; x++)
+    {
+        l2 += (double) exact[x] * exact[x];
+    }
+    const double bound = (kind == sketch::COUNT_MIN) ? std::exp(1.0) / w * N
+                                                     : std::sqrt(3.0 / w * l2);
+    const double heavy = phi * N;
+
+    uint64_t present = 0, over = 0, hh = 0, hh_found = 0, hh_false = 0;
+    double err_sum = 0, err_max = 0;
+    for (uint32_t x = 1; x <= universe; x++)
+    {
+        if (exact[x] >= heavy)
+        {
+            hh++;
+            hh_found += est[x] >= heavy;
+        }
+        else if (est[x] >= heavy)
+        {
+            hh_false++;
+        }
+        if (exact[x] == 0)
+            continue;
+        double err = std::fabs((double) est[x] - exact[x]);
+        present++;
+        err_sum += err;
+        err_max = std::max(err_max, err);
+        over += err > bound;
+    }
+
+    std::cout <<
+        " u=" << universe <<
+        " N=" << N <<
+        " seed=" << seed <<
+        " h=" << method <<
+        " name=" << rows[0]->getDescription() <<
+        " sketch=" << kind_names[kind] <<
+        " d=" << d <<
+        " w=" << w <<
+        " zipf=" << zipf <<
+        " threads=" << threads <<
+        " batch=" << batch <<
+        " time=" << time <<
+        " updates_per_s=" << N / time <<
+        " query_ns=" << query_time * 1e9 / universe <<
+        " sketch_bytes=" << sketch::bytes(s) <<
+        " hash_bytes=" << hash_bytes <<
+        " err_bound=" << bound <<
+        " avg_err=" << (present ? err_sum / present : 0) <<
+        " max_err=" << err_max <<
+        " over_bound=" << (present ? (double) over / present : 0) <<
+        " hh=" << hh <<
+        " hh_recall=" << (hh ? (double) hh_found / hh : 1) <<
+        " hh_false=" << hh_false <<
+        std::endl;
+
+    for (uint32_t i = 0; i < d; i++)
+        delete rows[i];
+}
+
+int main(int argc, char** argv)
+{
+    int only_method = -1;
+    uint32_t d = 4;
+    uint32_t w = 1 << 12;
+    uint32_t batch = 1024;
+    uint64_t length = 1 << 24;
+    double zipf = 1.1;
+    double phi = 0.001;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "m:d:w:b:N:z:k:p:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'm':
+                only_method = atoi(optarg);
+                break;
+            case 'd':
+                d = atoi(optarg);
+                break;
+            case 'w':
+                w = atoi(optarg);
+                break;
+            case 'b':
+                batch = atoi(optarg);
+                break;
+            case 'N':
+                length = atoll(optarg);
+                break;
+            case 'z':
+                zipf = atof(optarg);
+                break;
+            case 'k':
+                phi = atof(optarg);
+                break;
+            case 'p':
+                omp_set_num_threads(atoi(optarg));
+                break;
+            default:
+                return 0;
+        }
+    }
+    argv += optind - 1;
+    argc -= optind - 1;
+
+    if (argc < 2 || argc > 3 || d < 1 || d > sketch::MAX_ROWS || w < 1 || batch < 1 ||
+        length < 1 || length >= (1ULL << 31))
+    {
+        std::cout << "Usage: [-m method] [-d rows] [-w width] [-b batch] [-N length] [-z s] [-k phi] [-p threads] seed [u]" << std::endl;
+        std::cout << "Runs count-min and count sketches with d rows of w counters (default 4 and\n"
+                  << "2^12) over a stream of N keys (default 2^24, below 2^31) drawn from a Zipf\n"
+                  << "distribution with exponent s (default 1.1) over u keys (default 2^20).\n"
+                  << "Every row hashes b keys per call (default 1024). Keys with at least\n"
+                  << "phi * N occurrences are heavy hitters (default 0.001). -p updates with\n"
+                  << "threads sketches, merged at the end." << std::endl;
+        std::cout << "Available Methods: \n";
+        print_methods(std::cout);
+        return 0;
+    }
+
+    uint32_t seed = atoi(argv[1]);
+    uint32_t universe = (argc == 3) ? atoi(argv[2]) : (1 << 20);
+
+    std::vector<uint32_t> stream = create_zipf_stream(universe, length, zipf, seed);
+    std::vector<uint32_t> exact(universe + 1, 0);
+    for (uint64_t i = 0; i < length; i++)
+    {
+        exact[stream[i]]++;
+    }
+
+    for (int method = 0; method < NUM_METHODS; method++)
+    {
+        // fully random hash values are no function of the key
+        if (method == 12 || (only_method >= 0 && method != only_method))
+            continue;
+
+        for (int kind = 0; kind < sketch::NUM_KINDS; kind++)
+        {
+            bench(method, kind, seed, d, w, batch, zipf, phi, stream, exact);
+        }
+    }
+
+    return 0;
+}
@@ -0,0 +1,106 @@
+#ifndef SKETCHES_H
+#define SKETCHES_H
+
+#include <stdint.h>
+#include <vector>
+#include <algorithm>
+
+#include "hashfunctions.h"
+
+// Count-min and count sketches of a stream of keys. A sketch has d rows of
+// w counters, row i uses h1 of its own hash function rows[i] for the
+// column (mapped by multiply-shift, so w needs no power of two) and, in the
+// count sketch, the top bit of h2 as sign. Updates run in batches: every
+// row hashes the whole batch with one h1_many call and then adds to its
+// counters, so only one row and one hash function are in use at a time.
+// Counters are 32 bits, streams must stay below 2^31 keys; at most
+// MAX_ROWS rows.
+namespace sketch {
+
+    enum kind_t { COUNT_MIN, COUNT_SKETCH, NUM_KINDS };
+
+    static const uint32_t MAX_ROWS = 64;
+
+    struct Sketch {
+        int kind;
+        uint32_t d, w;
+        // row-major, row i at c[i * w]
+        std::vector<int32_t> c;
+    };
+
+    void init(Sketch& s, int kind, uint32_t d, uint32_t w)
+    {
+        s.kind = kind;
+        s.d = d;
+        s.w = w;
+        s.c.assign((size_t) d * w, 0);
+    }
+
+    inline uint32_t column(uint32_t hash, uint32_t w)
+    {
+        return ((uint64_t) hash * w) >> 32;
+    }
+
+    // add count keys, batch keys per hash call
+    void update(Sketch& s, const std::vector<HashFunction*>& rows, const uint32_t* keys, size_t count,
+                uint32_t batch)
+    {
+        std::vector<uint32_t> col(batch), sign(batch);
+        for (size_t b = 0; b < count; b += batch)
+        {
+            size_t len = std::min((size_t) batch, count - b);
+            for (uint32_t i = 0; i < s.d; i++)
+            {
+                int32_t* row = &s.c[(size_t) i * s.w];
+                rows[i]->h1_many(keys + b, col.data(), len);
+                if (s.kind == COUNT_MIN)
+                {
+                    for (size_t j = 0; j < len; j++)
+                        row[column(col[j], s.w)]++;
+                }
+                else
+                {
+                    rows[i]->h2_many(keys + b, sign.data(), len);
+                    for (size_t j = 0; j < len; j++)
+                        row[column(col[j], s.w)] += 1 - 2 * (int32_t) (sign[j] >> 31);
+                }
+            }
+        }
+    }
+
+    // add the counters of other, a sketch with the same hash functions
+    void merge(Sketch& s, const Sketch& other)
+    {
+        for (size_t i = 0; i < s.c.size(); i++)
+        {
+            s.c[i] += other.c[i];
+        }
+    }
+
+    // estimated count of key: the minimum over the rows (count-min) or the
+    // median of the signed counters (count sketch)
+    int64_t estimate(const Sketch& s, const std::vector<HashFunction*>& rows, uint32_t key)
+    {
+        int32_t v[MAX_ROWS] = { 0 };
+        const uint32_t d = s.d;
+        for (uint32_t i = 0; i < d; i++)
+        {
+            int32_t c = s.c[(size_t) i * s.w + column(rows[i]->h1(key), s.w)];
+            if (s.kind == COUNT_SKETCH && (rows[i]->h2(key) >> 31))
+                c = -c;
+            v[i] = c;
+        }
+        if (s.kind == COUNT_MIN)
+            return *std::min_element(v, v + d);
+
+        std::sort(v, v + d);
+        return (d % 2) ? v[d / 2] : ((int64_t) v[d / 2 - 1] + v[d / 2]) / 2;
+    }
+
+    size_t bytes(const Sketch& s)
+    {
+        return s.c.size() * sizeof(int32_t);
+    }
+}
+
+#endif // SKETCHES_H
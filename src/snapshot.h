@@ -0,0 +1,218 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/uio.h>
+#include <string>
+#include <sstream>
+#include <iostream>
+
+#include "hashfunctions.h"
+#include "methods.h"
+#include "cuckoohashing.h"
+
+// Snapshot of a cuckoo hash table and its hash function in one file:
+//
+//   header | hash function state | padding | t1 | t2 | stash
+//
+// The file is written with a single writev(). On loading it is mapped
+// privately, t1 and t2 point into the mapping and are usable at once;
+// pages are read on first access and copied on write. The hash function
+// is recreated from its method number and n without drawing parameters and
+// gets its state from the file, so no key is reinserted.
+namespace snapshot {
+
+    static const char MAGIC[8] = { 'C', 'U', 'C', 'K', 'O', 'O', 'S', 'N' };
+    static const uint32_t VERSION = 1;
+    static const uint64_t PAGE = 4096;
+
+    struct Header
+    {
+        char magic[8];
+        uint32_t version;
+        // method number of create_hash_function and its number of keys
+        uint32_t method;
+        uint32_t n;
+        // slots in each of t1 and t2
+        uint32_t m;
+        // getDescription() of the hash function, to check the family
+        char name[32];
+        uint64_t hash_offset, hash_bytes;
+        // t1 followed by t2, page aligned
+        uint64_t table_offset;
+        uint64_t stash_offset, stash_size;
+        uint64_t file_bytes;
+    };
+
+    // start and length of the current mapping
+    void* base = NULL;
+    size_t length = 0;
+
+    // write the cuckoo table built with hash function method for n keys
+    bool save(const std::string& path, int method, uint32_t n)
+    {
+        // a running resize is finished first, the file holds one table
+        if (cuckoohashing::old_t1 != NULL)
+            cuckoohashing::migrate(0);
+
+        std::ostringstream state;
+        cuckoohashing::h->saveState(state);
+        std::string hash = state.str();
+
+        Header hd;
+        memset(&hd, 0, sizeof(hd));
+        memcpy(hd.magic, MAGIC, sizeof(MAGIC));
+        hd.version = VERSION;
+        hd.method = method;
+        hd.n = n;
+        hd.m = cuckoohashing::m;
+        strncpy(hd.name, cuckoohashing::h->getDescription().c_str(), sizeof(hd.name) - 1);
+        hd.hash_offset = sizeof(Header);
+        hd.hash_bytes = hash.size();
+        hd.table_offset = (hd.hash_offset + hd.hash_bytes + PAGE - 1) / PAGE * PAGE;
+        hd.stash_offset = hd.table_offset + 2 * (uint64_t) hd.m * sizeof(uint32_t);
+        hd.stash_size = cuckoohashing::stash.size();
+        hd.file_bytes = hd.stash_offset + hd.stash_size * sizeof(uint32_t);
+
+        std::string head((const char*) &hd, sizeof(hd));
+        head += hash;
+        head.resize(hd.table_offset, 0);
+
+        struct iovec iov[4] = {
+            { (void*) head.data(), head.size() },
+            { cuckoohashing::t1, hd.m * sizeof(uint32_t) },
+            { cuckoohashing::t2, hd.m * sizeof(uint32_t) },
+            { cuckoohashing::stash.data(), hd.stash_size * sizeof(uint32_t) }
+        };
+
+        int fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0)
+        {
+            std::cerr << "snapshot: cannot create " << path << ": " << strerror(errno) << std::endl;
+            return false;
+        }
+
+        // writev may write less than requested for large tables
+        struct iovec* v = iov;
+        int cnt = 4;
+        while (cnt > 0)
+        {
+            ssize_t w = writev(fd, v, cnt);
+            if (w < 0)
+            {
+                std::cerr << "snapshot: cannot write " << path << ": " << strerror(errno) << std::endl;
+                close(fd);
+                return false;
+            }
+            while (cnt > 0 && (size_t) w >= v->iov_len)
+            {
+                w -= v->iov_len;
+                v++, cnt--;
+            }
+            if (cnt > 0)
+            {
+                v->iov_base = (char*) v->iov_base + w;
+                v->iov_len -= w;
+            }
+        }
+        close(fd);
+        return true;
+    }
+
+    // true if the section of bytes at offset ends within the mapping and
+    // starts at or after end, the end of the previous one; then moves end
+    // behind it
+    bool section(uint64_t offset, uint64_t bytes, uint64_t& end)
+    {
+        if (offset < end || offset > length || bytes > length - offset ||
+            offset % sizeof(uint32_t) != 0)
+            return false;
+        end = offset + bytes;
+        return true;
+    }
+
+    // map a snapshot into cuckoohashing; returns its hash function, or NULL
+    // if the file does not hold a table of hash function method for n keys
+    HashFunction* load(const std::string& path, int method, uint32_t n)
+    {
+        int fd = open(path.c_str(), O_RDONLY);
+        struct stat st;
+        if (fd < 0 || fstat(fd, &st) != 0)
+        {
+            std::cerr << "snapshot: cannot open " << path << ": " << strerror(errno) << std::endl;
+            if (fd >= 0) close(fd);
+            return NULL;
+        }
+
+        length = st.st_size;
+        base = (length < sizeof(Header)) ? MAP_FAILED
+            : mmap(NULL, length, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (base == MAP_FAILED)
+        {
+            std::cerr << "snapshot: cannot map " << path << std::endl;
+            base = NULL;
+            return NULL;
+        }
+
+        const Header& hd = *(const Header*) base;
+        const char* error = NULL;
+        uint64_t end = sizeof(Header);
+        if (memcmp(hd.magic, MAGIC, sizeof(MAGIC)) != 0 || hd.version != VERSION)
+            error = "not a snapshot of this version";
+        else if (hd.file_bytes != length)
+            error = "truncated file";
+        else if (hd.m == 0 || hd.stash_size > length ||
+                 !section(hd.hash_offset, hd.hash_bytes, end) ||
+                 !section(hd.table_offset, 2 * (uint64_t) hd.m * sizeof(uint32_t), end) ||
+                 !section(hd.stash_offset, hd.stash_size * sizeof(uint32_t), end))
+            error = "sections overlap or lie outside the file";
+        else if (hd.method != (uint32_t) method || hd.n != n)
+            error = "different hash function or number of keys";
+
+        HashFunction* h = NULL;
+        if (error == NULL)
+        {
+            h = create_hash_function(method, n, false);
+            std::istringstream state(std::string((const char*) base + hd.hash_offset, hd.hash_bytes));
+            if (h == NULL || !h->loadState(state) ||
+                h->getDescription().compare(0, sizeof(hd.name) - 1, hd.name) != 0)
+                error = "hash function state does not match";
+        }
+
+        if (error != NULL)
+        {
+            std::cerr << "snapshot: " << path << ": " << error << std::endl;
+            delete h;
+            munmap(base, length);
+            base = NULL;
+            return NULL;
+        }
+
+        uint32_t* t = (uint32_t*) ((char*) base + hd.table_offset);
+        const uint32_t* s = (const uint32_t*) ((char*) base + hd.stash_offset);
+        cuckoohashing::h = h;
+        cuckoohashing::m = hd.m;
+        cuckoohashing::t1 = t;
+        cuckoohashing::t2 = t + hd.m;
+        cuckoohashing::stash.assign(s, s + hd.stash_size);
+        cuckoohashing::storage = cuckoohashing::MAPPED;
+        return h;
+    }
+
+    // unmap the snapshot after cuckoohashing::destroy()
+    void unmap()
+    {
+        if (base != NULL)
+            munmap(base, length);
+        base = NULL;
+    }
+}
+
+#endif // SNAPSHOT_H
@@ -0,0 +1,208 @@
+#ifndef SWISSTABLE_H
+#define SWISSTABLE_H
+
+#include <stdint.h>
+#include <cmath>
+#include <vector>
+#include <iostream>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "hashfunctions.h"
+
+// Open addressing with one control byte per slot, probed in groups of 16
+// slots (Swiss table layout). A full slot's control byte holds a 7-bit tag
+// taken from the high bits of h1, the group is chosen by the low bits.
+// Groups are probed triangularly, a probe sequence ends at the first group
+// containing an empty slot. Control bytes, keys and values sit in separate
+// arrays.
+namespace swisstable {
+
+    static const uint32_t GROUP = 16;
+    static const int8_t EMPTY = -128;
+    static const int8_t DELETED = -2;
+
+    int8_t* ctrl;
+    uint32_t* keys;
+    uint32_t* vals;
+
+    // number of groups, a power of two
+    uint32_t ngroups;
+    uint32_t slots;
+
+    HashFunction* h;
+
+    uint64_t group_probes;
+    uint64_t false_matches;
+    uint64_t tag_count[128];
+
+    // bitmask of the slots in group g whose control byte equals c
+    inline uint32_t match(uint32_t g, int8_t c)
+    {
+#ifdef __SSE2__
+        __m128i ctl = _mm_loadu_si128((const __m128i*) (ctrl + g * GROUP));
+        return _mm_movemask_epi8(_mm_cmpeq_epi8(ctl, _mm_set1_epi8(c)));
+#else
+        uint32_t mask = 0;
+        for (uint32_t i = 0; i < GROUP; i++)
+            if (ctrl[g * GROUP + i] == c)
+                mask |= 1 << i;
+        return mask;
+#endif
+    }
+
+    // bitmask of the slots in group g that are empty or deleted
+    inline uint32_t match_free(uint32_t g)
+    {
+#ifdef __SSE2__
+        // control bytes of free slots have the sign bit set
+        __m128i ctl = _mm_loadu_si128((const __m128i*) (ctrl + g * GROUP));
+        return _mm_movemask_epi8(ctl);
+#else
+        uint32_t mask = 0;
+        for (uint32_t i = 0; i < GROUP; i++)
+            if (ctrl[g * GROUP + i] < 0)
+                mask |= 1 << i;
+        return mask;
+#endif
+    }
+
+    // create a table with at least _m slots
+    void init(uint32_t _m, HashFunction* _h)
+    {
+        h = _h;
+        ngroups = 1;
+        while (ngroups * GROUP < _m)
+            ngroups <<= 1;
+        slots = ngroups * GROUP;
+
+        ctrl = new int8_t[slots];
+        keys = new uint32_t[slots];
+        vals = new uint32_t[slots];
+
+        for (uint32_t i = 0; i < slots; i++)
+        {
+            ctrl[i] = EMPTY;
+            keys[i] = 0;
+            vals[i] = 0;
+        }
+
+        group_probes = 0;
+        false_matches = 0;
+        for (uint32_t i = 0; i < 128; i++)
+            tag_count[i] = 0;
+    }
+
+    void destroy()
+    {
+        delete[] ctrl;
+        delete[] keys;
+        delete[] vals;
+    }
+
+    void memory_regions(std::vector<MemoryRegion>& regions)
+    {
+        regions.push_back(MemoryRegion{ ctrl, slots * sizeof(int8_t) });
+        regions.push_back(MemoryRegion{ keys, slots * sizeof(uint32_t) });
+        regions.push_back(MemoryRegion{ vals, slots * sizeof(uint32_t) });
+    }
+
+    // slot of key, or slots if key is not present
+    uint32_t find(uint32_t key)
+    {
+        uint32_t hash = h->h1(key);
+        int8_t tag = hash >> 25;
+        uint32_t g = hash & (ngroups - 1);
+
+        for (uint32_t i = 1; i <= ngroups; i++)
+        {
+            for (uint32_t mask = match(g, tag); mask; mask &= mask - 1)
+            {
+                uint32_t s = g * GROUP + __builtin_ctz(mask);
+                if (keys[s] == key)
+                    return s;
+            }
+            if (match(g, EMPTY))
+                break;
+            g = (g + i) & (ngroups - 1);
+        }
+        return slots;
+    }
+
+    bool lookup(uint32_t key)
+    {
+        return find(key) != slots;
+    }
+
+    void insert(uint32_t key, uint32_t value)
+    {
+        uint32_t hash = h->h1(key);
+        int8_t tag = hash >> 25;
+        uint32_t g = hash & (ngroups - 1);
+        uint32_t target = slots;
+
+        for (uint32_t i = 1; i <= ngroups; i++)
+        {
+            group_probes++;
+            for (uint32_t mask = match(g, tag); mask; mask &= mask - 1)
+            {
+                uint32_t s = g * GROUP + __builtin_ctz(mask);
+                if (keys[s] == key)
+                {
+                    vals[s] = value;
+                    return;
+                }
+                false_matches++;
+            }
+            uint32_t free = match_free(g);
+            if (target == slots && free)
+                target = g * GROUP + __builtin_ctz(free);
+            if (match(g, EMPTY))
+                break;
+            g = (g + i) & (ngroups - 1);
+        }
+
+        // the driver never fills more than half of the slots
+        ctrl[target] = tag;
+        keys[target] = key;
+        vals[target] = value;
+        tag_count[(uint8_t) tag]++;
+    }
+
+    void remove(uint32_t key)
+    {
+        uint32_t s = find(key);
+        if (s == slots)
+            return;
+        // if the group still has an empty slot, no probe sequence has
+        // passed through it and the slot can become empty again
+        ctrl[s] = match(s / GROUP, EMPTY) ? EMPTY : DELETED;
+    }
+
+    // print group probes and false tag matches per insert and the entropy
+    // of the tags of all inserted keys in bits (at most 7)
+    void print_stats(std::ostream& os, uint64_t inserts)
+    {
+        uint64_t total = 0;
+        for (uint32_t i = 0; i < 128; i++)
+            total += tag_count[i];
+
+        double entropy = 0;
+        for (uint32_t i = 0; i < 128; i++)
+        {
+            if (tag_count[i] == 0)
+                continue;
+            double p = (double) tag_count[i] / total;
+            entropy -= p * log2(p);
+        }
+
+        os << " slots=" << slots
+           << " group_probe_avg=" << (inserts ? (double) group_probes / inserts : 0)
+           << " tag_false_matches=" << (inserts ? (double) false_matches / inserts : 0)
+           << " tag_entropy=" << entropy;
+    }
+}
+
+#endif // SWISSTABLE_H
@@ -0,0 +1,89 @@
+/******************************************************************************
+ * src/tools/cache.h
+ *
+ * Helpers to bring memory into a defined cache state before measurements:
+ * flushing regions with clflush, touching them, and evicting all caches by
+ * streaming through a large buffer.
+ *
+ ******************************************************************************
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#ifndef TOOLS_CACHE_H
+#define TOOLS_CACHE_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <vector>
+#include <emmintrin.h>
+
+static const size_t cache_line_size = 64;
+
+//! keep the compiler from discarding the computation of v
+template <typename T>
+inline void escape(const T& v)
+{
+    __asm__ __volatile__ ("" : : "r,m"(v) : "memory");
+}
+
+//! flush all cache lines of a region from every cache level
+inline void flush_region(const void* p, size_t bytes)
+{
+    const char* c = (const char*) ((uintptr_t) p & ~(uintptr_t) (cache_line_size - 1));
+    const char* end = (const char*) p + bytes;
+    for ( ; c < end; c += cache_line_size)
+    {
+        _mm_clflush(c);
+    }
+    _mm_mfence();
+}
+
+//! read all cache lines of a region
+inline void touch_region(const void* p, size_t bytes)
+{
+    const char* c = (const char*) p;
+    char sum = 0;
+    for (size_t i = 0; i < bytes; i += cache_line_size)
+    {
+        sum ^= c[i];
+    }
+    escape(sum);
+}
+
+//! Evicts all caches by writing and reading a buffer larger than the last
+//! level cache.
+class CacheEvictor
+{
+protected:
+    std::vector<uint64_t> m_buffer;
+
+public:
+    CacheEvictor(size_t bytes)
+        : m_buffer(bytes / sizeof(uint64_t), 0)
+    {
+    }
+
+    void evict()
+    {
+        uint64_t sum = 0;
+        for (size_t i = 0; i < m_buffer.size(); i += cache_line_size / sizeof(uint64_t))
+        {
+            m_buffer[i]++;
+            sum += m_buffer[i];
+        }
+        escape(sum);
+    }
+};
+
+#endif // TOOLS_CACHE_H
@@ -0,0 +1,194 @@
+/******************************************************************************
+ * src/tools/cachesim.h
+ *
+ * Software accounting of cache lines touched by table operations and a
+ * set-associative LRU simulation of a cache hierarchy, for machines without
+ * hardware counters. TRACE_READ and TRACE_OPERATION only record anything
+ * when compiled with -DWITH_CACHE_SIM.
+ *
+ ******************************************************************************
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#ifndef TOOLS_CACHESIM_H
+#define TOOLS_CACHESIM_H
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <utility>
+#include <algorithm>
+
+#include "cache.h"
+
+//! One set-associative cache level with LRU replacement
+class LRUCache
+{
+protected:
+    size_t m_sets;
+    size_t m_ways;
+    //! m_ways lines per set, most recently used first, 0 for invalid
+    std::vector<uint64_t> m_tags;
+
+public:
+    uint64_t misses;
+
+    LRUCache(size_t bytes, size_t ways)
+        : m_ways(ways), misses(0)
+    {
+        m_sets = std::max((size_t) 1, bytes / (cache_line_size * ways));
+        m_tags.assign(m_sets * m_ways, 0);
+    }
+
+    //! access a line, returns true on a hit
+    bool access(uint64_t line)
+    {
+        uint64_t tag = line + 1;
+        uint64_t* set = &m_tags[(line % m_sets) * m_ways];
+        size_t w = 0;
+        while (w < m_ways - 1 && set[w] != tag)
+            w++;
+        bool hit = (set[w] == tag);
+        // move to front, evicting the last way on a miss
+        for ( ; w > 0; w--)
+            set[w] = set[w - 1];
+        set[0] = tag;
+        if (!hit) misses++;
+        return hit;
+    }
+
+    void clear()
+    {
+        std::fill(m_tags.begin(), m_tags.end(), 0);
+    }
+};
+
+//! Counts the distinct cache lines touched per operation and simulates
+//! every touch in a hierarchy of LRU caches. A line missing in one level is
+//! looked up in the next; levels are neither inclusive nor exclusive.
+class CacheSimulator
+{
+protected:
+    std::vector<LRUCache> m_levels;
+    std::vector<uint64_t> m_lines;
+    int m_depth;
+
+public:
+    //! number of finished operations and distinct lines touched by them
+    uint64_t ops, lines;
+
+    //! default geometry in KB:ways per level, from L1 to the LLC
+    CacheSimulator(const std::string& geometry = "32:8,1024:16,32768:16")
+        : m_depth(0), ops(0), lines(0)
+    {
+        configure(geometry);
+    }
+
+    //! set the geometry as comma separated list of size_in_KB:ways
+    void configure(const std::string& geometry)
+    {
+        m_levels.clear();
+        std::istringstream is(geometry);
+        std::string level;
+        while (std::getline(is, level, ','))
+        {
+            size_t kb = atol(level.c_str());
+            size_t colon = level.find(':');
+            size_t ways = (colon == std::string::npos) ? 8 : atol(level.c_str() + colon + 1);
+            if (kb > 0 && ways > 0)
+                m_levels.push_back(LRUCache(kb << 10, ways));
+        }
+    }
+
+    //! record a memory access, ignored outside of operations
+    void touch(const void* p)
+    {
+        if (m_depth == 0) return;
+        uint64_t line = (uintptr_t) p / cache_line_size;
+        m_lines.push_back(line);
+        for (size_t i = 0; i < m_levels.size() && !m_levels[i].access(line); i++) { }
+    }
+
+    void begin_operation()
+    {
+        m_depth++;
+    }
+
+    void end_operation()
+    {
+        if (--m_depth > 0) return;
+        std::sort(m_lines.begin(), m_lines.end());
+        lines += std::unique(m_lines.begin(), m_lines.end()) - m_lines.begin();
+        m_lines.clear();
+        ops++;
+    }
+
+    //! empty all simulated caches
+    void flush()
+    {
+        for (size_t i = 0; i < m_levels.size(); i++)
+            m_levels[i].clear();
+    }
+
+    //! current totals as counters sim_ops, sim_lines, sim_L<i>_miss
+    std::vector< std::pair<std::string, long long> > counters() const
+    {
+        std::vector< std::pair<std::string, long long> > res;
+        res.push_back(std::make_pair(std::string("sim_ops"), (long long) ops));
+        res.push_back(std::make_pair(std::string("sim_lines"), (long long) lines));
+        for (size_t i = 0; i < m_levels.size(); i++)
+        {
+            std::ostringstream name;
+            name << "sim_L" << i + 1 << "_miss";
+            res.push_back(std::make_pair(name.str(), (long long) m_levels[i].misses));
+        }
+        return res;
+    }
+};
+
+//! the simulator fed by TRACE_READ and TRACE_OPERATION
+inline CacheSimulator& cache_simulator()
+{
+    static CacheSimulator sim;
+    return sim;
+}
+
+//! marks the enclosing scope as one operation
+class TraceOperation
+{
+public:
+    TraceOperation() { cache_simulator().begin_operation(); }
+    ~TraceOperation() { cache_simulator().end_operation(); }
+};
+
+template <typename T>
+inline const T& trace_read(const T& v)
+{
+    cache_simulator().touch(&v);
+    return v;
+}
+
+#ifdef WITH_CACHE_SIM
+//! read an lvalue and record the cache line it lies on
+#define TRACE_READ(x) trace_read(x)
+//! count the rest of the enclosing scope as one operation
+#define TRACE_OPERATION TraceOperation trace_operation
+#else
+#define TRACE_READ(x) (x)
+#define TRACE_OPERATION
+#endif
+
+#endif // TOOLS_CACHESIM_H
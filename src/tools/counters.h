@@ -0,0 +1,40 @@
+/******************************************************************************
+ * src/tools/counters.h
+ *
+ * Selects the performance counter backend: PAPI if compiled WITH_PAPI, else
+ * Linux perf_event_open if compiled WITH_PERF_EVENT, else no counters. All
+ * backends take PAPI preset names like PAPI_TOT_CYC.
+ *
+ ******************************************************************************
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#ifndef TOOLS_COUNTERS_H
+#define TOOLS_COUNTERS_H
+
+#if !defined(WITH_PAPI) && defined(WITH_PERF_EVENT)
+
+#include "perf.h"
+
+typedef PerfEventWrapper CounterWrapper;
+
+#else
+
+#include "papi.h"
+
+typedef PApiWrapper CounterWrapper;
+
+#endif
+
+#endif // TOOLS_COUNTERS_H
@@ -0,0 +1,51 @@
+/******************************************************************************
+ * src/tools/memory.h
+ *
+ * Process memory statistics: peak resident set size and the size of the L2
+ * cache, to relate the memory held by hash functions and tables to it.
+ *
+ ******************************************************************************
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#ifndef TOOLS_MEMORY_H
+#define TOOLS_MEMORY_H
+
+#include <stddef.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+//! peak resident set size of the process in bytes
+inline size_t peak_rss_bytes()
+{
+    struct rusage ru;
+    if (getrusage(RUSAGE_SELF, &ru) != 0)
+        return 0;
+    // ru_maxrss is given in kilobytes on Linux
+    return (size_t) ru.ru_maxrss * 1024;
+}
+
+//! size of the L2 cache of one core in bytes, 0 if unknown
+inline size_t l2_cache_bytes()
+{
+#ifdef _SC_LEVEL2_CACHE_SIZE
+    long s = sysconf(_SC_LEVEL2_CACHE_SIZE);
+    if (s > 0)
+        return s;
+#endif
+    return 0;
+}
+
+#endif // TOOLS_MEMORY_H
@@ -228,6 +228,8 @@ struct PApiWrapper
     PApiWrapper() { }
     bool available() const { return false; }
     void add_event(int) { }
+    bool add_event(const std::string&) { return false; }
+    bool add_event_list(const std::string&) { return false; }
     void start() { }
     void stop() { }
     void report() { }
@@ -0,0 +1,438 @@
+/******************************************************************************
+ * src/tools/perf.h
+ *
+ * Wrapper class to the Linux perf_event_open interface for access to
+ * performance counters without libpapi. Same interface as PApiWrapper.
+ *
+ ******************************************************************************
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#ifndef TOOLS_PERF_H
+#define TOOLS_PERF_H
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <stdlib.h>
+#include <string>
+#include <iostream>
+#include <assert.h>
+
+#include "debug.h"
+
+//! Counts events of the calling thread in user space. Events are opened in
+//! groups of at most max_group counters, which the kernel schedules onto the
+//! PMU together; if there are more groups than the PMU can hold, they are
+//! multiplexed and the counts are scaled by time_enabled / time_running.
+//! start() and stop() take snapshots of the running counters, if the kernel
+//! allows it with rdpmc from user space, otherwise with one read() per group.
+class PerfEventWrapper
+{
+protected:
+
+    static const bool debug = false;
+
+    static const int max_events = 32;
+
+    static const int max_group = 4;
+
+    struct snapshot
+    {
+        uint64_t value, enabled, running;
+    };
+
+    bool m_available;
+
+    int num_events;
+    std::string name[max_events];
+    int fd[max_events];
+    int leader[max_events];
+    perf_event_mmap_page* page[max_events];
+
+    snapshot begin[max_events];
+    long long values[max_events];
+
+    //! translate a PAPI preset or perf event name to an event attribute
+    static bool lookup_event(const std::string& event_name, perf_event_attr& attr)
+    {
+        static const struct { const char* name; uint32_t type; uint64_t config; } table[] = {
+            { "PAPI_TOT_INS", PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+            { "PAPI_TOT_CYC", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+            { "PAPI_REF_CYC", PERF_TYPE_HARDWARE, PERF_COUNT_HW_REF_CPU_CYCLES },
+            { "PAPI_BR_INS", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS },
+            { "PAPI_BR_CN", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_INSTRUCTIONS },
+            { "PAPI_BR_MSP", PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+            { "PAPI_L3_TCM", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES },
+            { "PAPI_L3_TCA", PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_REFERENCES },
+            // L1 total misses are approximated by L1 data read misses
+            { "PAPI_L1_TCM", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+              (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+            { "PAPI_L1_DCM", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D |
+              (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+            { "PAPI_L1_ICM", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1I |
+              (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+            { "PAPI_TLB_DM", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_DTLB |
+              (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+            { "PAPI_TLB_IM", PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_ITLB |
+              (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+            { "task-clock", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_TASK_CLOCK },
+            { "page-faults", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS },
+            { "context-switches", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES },
+            { "cpu-migrations", PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CPU_MIGRATIONS },
+        };
+
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+
+        for (size_t i = 0; i < sizeof(table) / sizeof(table[0]); ++i)
+        {
+            if (event_name == table[i].name) {
+                attr.type = table[i].type;
+                attr.config = table[i].config;
+                return true;
+            }
+        }
+
+        // PAPI_L2_TCM has no generic perf event, use L2_RQSTS.MISS on Intel
+        // and L2_CACHE_REQ_STAT.IC_DC_MISS_IN_L2 on AMD Zen
+        if (event_name == "PAPI_L2_TCM" && is_intel()) {
+            attr.type = PERF_TYPE_RAW;
+            attr.config = 0x3f24;
+            return true;
+        }
+        if (event_name == "PAPI_L2_TCM" && is_amd_zen()) {
+            attr.type = PERF_TYPE_RAW;
+            attr.config = 0x0964;
+            return true;
+        }
+
+        // raw event code in perf notation, e.g. r3f24
+        if (event_name.size() > 1 && event_name[0] == 'r') {
+            char* end;
+            attr.type = PERF_TYPE_RAW;
+            attr.config = strtoull(event_name.c_str() + 1, &end, 16);
+            return *end == 0;
+        }
+
+        return false;
+    }
+
+    static bool is_intel()
+    {
+        uint32_t a, b, c, d;
+        __asm__ __volatile__ ("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "a"(0));
+        return b == 0x756e6547; // "Genu"
+    }
+
+    static bool is_amd_zen()
+    {
+        uint32_t a, b, c, d;
+        __asm__ __volatile__ ("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "a"(0));
+        if (b != 0x68747541) // "Auth"
+            return false;
+        __asm__ __volatile__ ("cpuid" : "=a"(a), "=b"(b), "=c"(c), "=d"(d) : "a"(1));
+        uint32_t family = (a >> 8) & 0xf;
+        if (family == 0xf)
+            family += (a >> 20) & 0xff;
+        return family >= 0x17;
+    }
+
+    static uint64_t rdtsc()
+    {
+        uint32_t lo, hi;
+        __asm__ __volatile__ ("rdtsc" : "=a"(lo), "=d"(hi));
+        return lo | ((uint64_t) hi << 32);
+    }
+
+    static uint64_t rdpmc(uint32_t counter)
+    {
+        uint32_t lo, hi;
+        __asm__ __volatile__ ("rdpmc" : "=a"(lo), "=d"(hi) : "c"(counter));
+        return lo | ((uint64_t) hi << 32);
+    }
+
+    //! read counter i from user space, false if the kernel does not allow it
+    //! or the event is not running all the time it is enabled. time_enabled
+    //! and time_running of the control page are only updated when the event
+    //! is scheduled, the time since then is derived from the TSC as
+    //! described in perf_event.h.
+    bool read_user(int i, snapshot& s) const
+    {
+        volatile perf_event_mmap_page* pc = page[i];
+        if (pc == NULL) return false;
+
+        uint32_t seq, idx;
+        int64_t count;
+        uint64_t enabled, running, cyc;
+        uint64_t time_offset;
+        uint32_t time_mult, time_shift;
+        do {
+            seq = pc->lock;
+            __asm__ __volatile__ ("" ::: "memory");
+
+            idx = pc->index;
+            if (!pc->cap_user_rdpmc || !pc->cap_user_time || idx == 0) return false;
+
+            enabled = pc->time_enabled;
+            running = pc->time_running;
+            cyc = rdtsc();
+            time_offset = pc->time_offset;
+            time_mult = pc->time_mult;
+            time_shift = pc->time_shift;
+
+            count = pc->offset;
+            int shift = 64 - pc->pmc_width;
+            count += (int64_t) (rdpmc(idx - 1) << shift) >> shift;
+
+            __asm__ __volatile__ ("" ::: "memory");
+        } while (pc->lock != seq);
+
+        // multiplexed events are scaled with the times of read()
+        if (running != enabled) return false;
+
+        uint64_t quot = cyc >> time_shift;
+        uint64_t rem = cyc & (((uint64_t) 1 << time_shift) - 1);
+        uint64_t delta = time_offset + quot * time_mult + ((rem * time_mult) >> time_shift);
+
+        s.value = count;
+        s.enabled = enabled + delta;
+        s.running = running + delta;
+        return true;
+    }
+
+    //! add an event that cannot be counted here and is reported as -1, so
+    //! the output has the same fields on every machine
+    void add_unsupported(const std::string& event_name)
+    {
+        int i = num_events++;
+        name[i] = event_name;
+        fd[i] = -1;
+        leader[i] = i;
+        page[i] = NULL;
+    }
+
+    //! take a snapshot of all counters
+    void read_all(snapshot* s) const
+    {
+        for (int g = 0; g < num_events; )
+        {
+            // members of the group led by event g
+            int end = g + 1;
+            while (end < num_events && leader[end] == g) ++end;
+
+            if (fd[g] < 0)
+            {
+                // event without a mapping on this CPU
+                memset(&s[g], 0, sizeof(s[g]));
+                g = end;
+                continue;
+            }
+
+            // all members from rdpmc or all from one read() of the group
+            bool user = true;
+            for (int i = g; i < end && user; ++i)
+            {
+                user = read_user(i, s[i]);
+            }
+
+            if (!user)
+            {
+                // PERF_FORMAT_GROUP: nr, time_enabled, time_running, values
+                uint64_t buf[3 + max_group];
+                if (read(fd[g], buf, sizeof(buf)) < (ssize_t) (3 + end - g) * 8) {
+                    DBG(debug, "read(): " << strerror(errno));
+                    memset(buf, 0, sizeof(buf));
+                }
+                for (int i = g; i < end; ++i)
+                {
+                    s[i].value = buf[3 + i - g];
+                    s[i].enabled = buf[1];
+                    s[i].running = buf[2];
+                }
+            }
+            g = end;
+        }
+    }
+
+public:
+
+    //! check that perf_event_open exists
+    PerfEventWrapper()
+        : m_available(false),
+          num_events(0)
+    {
+        perf_event_attr attr;
+        lookup_event("task-clock", attr);
+        attr.exclude_kernel = 1;
+
+        int probe = syscall(__NR_perf_event_open, &attr, 0, -1, -1, 0);
+        if (probe < 0) {
+            DBG(debug, "perf_event_open(): " << strerror(errno));
+            return;
+        }
+        close(probe);
+
+        m_available = true;
+    }
+
+    ~PerfEventWrapper()
+    {
+        long pagesize = sysconf(_SC_PAGESIZE);
+        for (int i = 0; i < num_events; ++i)
+        {
+            if (page[i]) munmap(page[i], pagesize);
+            if (fd[i] >= 0) close(fd[i]);
+        }
+    }
+
+    //! true if perf events are available
+    bool available() const
+    {
+        return m_available;
+    }
+
+    //! add an event by name to the event set
+    bool add_event(const std::string& event_name)
+    {
+        if (!m_available || num_events == max_events) return false;
+
+        // accept PAPI preset names without the PAPI_ prefix
+        perf_event_attr attr;
+        if (!lookup_event(event_name, attr)) {
+            if (event_name.compare(0, 5, "PAPI_") != 0)
+                return add_event("PAPI_" + event_name);
+            if (event_name == "PAPI_L2_TCM") {
+                std::cerr << "perf: " << event_name << " is not supported on this CPU, reported as -1"
+                          << std::endl;
+                add_unsupported(event_name);
+                return false;
+            }
+            std::cerr << "perf: unknown event " << event_name << std::endl;
+            return false;
+        }
+
+        // start a new group if there is none or the last one is full
+        int g = num_events - 1;
+        if (g >= 0) g = leader[g];
+        if (g < 0 || fd[g] < 0 || num_events - g >= max_group) g = -1;
+
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP
+            | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+
+        int f = syscall(__NR_perf_event_open, &attr, 0, -1, g < 0 ? -1 : fd[g], 0);
+        if (f < 0) {
+            std::cerr << "perf_event_open(" << event_name << "): "
+                      << strerror(errno) << ", reported as -1" << std::endl;
+            add_unsupported(event_name);
+            return false;
+        }
+
+        int i = num_events++;
+        name[i] = event_name;
+        fd[i] = f;
+        leader[i] = g < 0 ? i : g;
+
+        // map the control page for rdpmc, which is optional
+        void* p = mmap(NULL, sysconf(_SC_PAGESIZE), PROT_READ, MAP_SHARED, f, 0);
+        page[i] = (p == MAP_FAILED) ? NULL : (perf_event_mmap_page*) p;
+
+        return true;
+    }
+
+    //! add an event list by name to the event set
+    bool add_event_list(const std::string& event_list)
+    {
+        std::string::size_type pos = 0;
+
+        while ( pos < event_list.size() )
+        {
+            size_t endpos = event_list.find_first_of(",:;", pos);
+
+            add_event(event_list.substr(pos, endpos - pos));
+
+            if (endpos == std::string::npos) break;
+            pos = endpos+1;
+        }
+
+        return true;
+    }
+
+    //! Start event counting
+    void start()
+    {
+        if (!m_available) return;
+
+        read_all(begin);
+    }
+
+    //! Stop event counting and retrieve results
+    void stop()
+    {
+        if (!m_available) return;
+
+        snapshot end[max_events];
+        read_all(end);
+
+        for (int i = 0; i < num_events; ++i)
+        {
+            double delta = end[i].value - begin[i].value;
+            uint64_t running = end[i].running - begin[i].running;
+            uint64_t enabled = end[i].enabled - begin[i].enabled;
+
+            // scale multiplexed counts
+            if (running > 0 && running < enabled)
+                delta *= (double) enabled / running;
+
+            values[i] = (fd[i] < 0) ? -1 : (long long) delta;
+        }
+    }
+
+    //! Print out status report of all event counters
+    void report()
+    {
+        for (int i = 0; i < num_events; ++i)
+        {
+            OUT(1, "COUNTER(" << name[i] << ") = " << values[i]);
+        }
+    }
+
+    //! Return number of event counters
+    size_t get_num_counter() const
+    {
+        return num_events;
+    }
+
+    //! Return numeric values of an event counter
+    long long get_counter_result(int num) const
+    {
+        assert(num < max_events);
+        return values[num];
+    }
+
+    //! Return name of event counter
+    std::string get_counter_name(int num) const
+    {
+        return name[num];
+    }
+};
+
+#endif // TOOLS_PERF_H
@@ -0,0 +1,185 @@
+/******************************************************************************
+ * src/tools/scope.h
+ *
+ * RAII measurement scopes: wall time, CPU time and performance counters of
+ * a named phase, emitted as key=value pairs prefixed by the phase name.
+ *
+ ******************************************************************************
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#ifndef TOOLS_SCOPE_H
+#define TOOLS_SCOPE_H
+
+#include <string>
+#include <vector>
+#include <utility>
+#include <iostream>
+
+#include "timer.h"
+#include "counters.h"
+#include "cachesim.h"
+
+//! Measured values of one phase
+struct ScopeResult
+{
+    std::string name;
+    double time;
+    double cpu_time;
+    std::vector< std::pair<std::string, long long> > counters;
+
+    //! value of a counter, or -1 if it was not measured
+    long long counter(const std::string& counter_name) const
+    {
+        for (size_t i = 0; i < counters.size(); ++i)
+        {
+            if (counters[i].first == counter_name)
+                return counters[i].second;
+        }
+        return -1;
+    }
+};
+
+//! List of measured phases in order of completion
+class ScopeResults : public std::vector<ScopeResult>
+{
+public:
+    //! find the result of a phase, NULL if it was not measured
+    const ScopeResult* find(const std::string& name) const
+    {
+        for (const_iterator it = begin(); it != end(); ++it)
+        {
+            if (it->name == name) return &*it;
+        }
+        return NULL;
+    }
+
+    //! print all phases as " <phase>_time=... <phase>_<counter>=..."
+    void print(std::ostream& os) const
+    {
+        for (const_iterator it = begin(); it != end(); ++it)
+        {
+            os << " " << it->name << "_time=" << it->time
+               << " " << it->name << "_cpu_time=" << it->cpu_time;
+            for (size_t i = 0; i < it->counters.size(); ++i)
+            {
+                os << " " << it->name << "_" << it->counters[i].first
+                   << "=" << it->counters[i].second;
+            }
+        }
+    }
+};
+
+//! Measures a phase from construction until stop() or destruction and
+//! appends the result to a ScopeResults list. The counters are started
+//! first and stopped last, as in the original insert measurement. A phase
+//! interleaved with another one is measured in intervals: pause() and
+//! resume() exclude the time between them, the result is the sum over all
+//! intervals. Only one scope may run at a time.
+class MeasureScope
+{
+protected:
+    std::string m_name;
+    CounterWrapper& m_counters;
+    ScopeResults& m_results;
+    bool m_running;
+    bool m_recorded;
+
+    ClockIntervalBase<CLOCK_MONOTONIC> m_timer;
+    ClockIntervalBase<CLOCK_PROCESS_CPUTIME_ID> m_cpu_timer;
+
+    //! sums over the finished intervals
+    ScopeResult m_sum;
+
+#ifdef WITH_CACHE_SIM
+    //! simulator totals at the start of the interval
+    std::vector< std::pair<std::string, long long> > m_sim_start;
+#endif
+
+public:
+    //! running = false creates the scope paused, to be started by resume()
+    MeasureScope(const std::string& name, CounterWrapper& counters, ScopeResults& results,
+                 bool running = true)
+        : m_name(name), m_counters(counters), m_results(results), m_running(false),
+          m_recorded(false)
+    {
+        m_sum.name = m_name;
+        m_sum.time = m_sum.cpu_time = 0;
+        for (size_t i = 0; i < m_counters.get_num_counter(); ++i)
+        {
+            m_sum.counters.push_back(std::make_pair(m_counters.get_counter_name(i), 0LL));
+        }
+#ifdef WITH_CACHE_SIM
+        std::vector< std::pair<std::string, long long> > sim = cache_simulator().counters();
+        for (size_t i = 0; i < sim.size(); ++i)
+        {
+            m_sum.counters.push_back(std::make_pair(sim[i].first, 0LL));
+        }
+#endif
+        if (running) resume();
+    }
+
+    ~MeasureScope()
+    {
+        stop();
+    }
+
+    //! start a new interval
+    void resume()
+    {
+        if (m_running || m_recorded) return;
+        m_running = true;
+#ifdef WITH_CACHE_SIM
+        m_sim_start = cache_simulator().counters();
+#endif
+        m_counters.start(), m_cpu_timer.start(), m_timer.start();
+    }
+
+    //! end the current interval and add it to the sums
+    void pause()
+    {
+        if (!m_running) return;
+        m_timer.stop(), m_cpu_timer.stop(), m_counters.stop();
+        m_running = false;
+
+        m_sum.time += m_timer.delta();
+        m_sum.cpu_time += m_cpu_timer.delta();
+        size_t i = 0;
+        for ( ; i < m_counters.get_num_counter(); ++i)
+        {
+            // -1: the counter is not available
+            long long v = m_counters.get_counter_result(i);
+            long long& sum = m_sum.counters[i].second;
+            sum = (v < 0 || sum < 0) ? -1 : sum + v;
+        }
+#ifdef WITH_CACHE_SIM
+        std::vector< std::pair<std::string, long long> > sim = cache_simulator().counters();
+        for (size_t j = 0; j < sim.size(); ++j, ++i)
+        {
+            m_sum.counters[i].second += sim[j].second - m_sim_start[j].second;
+        }
+#endif
+    }
+
+    //! stop measuring and record the result
+    void stop()
+    {
+        if (m_recorded) return;
+        pause();
+        m_recorded = true;
+        m_results.push_back(m_sum);
+    }
+};
+
+#endif // TOOLS_SCOPE_H
@@ -0,0 +1,207 @@
+/******************************************************************************
+ * src/tools/stats.h
+ *
+ * Aggregation of the key=value output of repeated trials of one
+ * configuration: mean, median, standard deviation, 95% confidence interval
+ * and minimum of every numeric field.
+ *
+ ******************************************************************************
+ * This program is free software: you can redistribute it and/or modify it
+ * under the terms of the GNU General Public License as published by the Free
+ * Software Foundation, either version 3 of the License, or (at your option)
+ * any later version.
+ *
+ * This program is distributed in the hope that it will be useful, but WITHOUT
+ * ANY WARRANTY; without even the implied warranty of MERCHANTABILITY or
+ * FITNESS FOR A PARTICULAR PURPOSE.  See the GNU General Public License for
+ * more details.
+ *
+ * You should have received a copy of the GNU General Public License along with
+ * this program.  If not, see <http://www.gnu.org/licenses/>.
+ *****************************************************************************/
+
+#ifndef TOOLS_STATS_H
+#define TOOLS_STATS_H
+
+#include <stdlib.h>
+#include <cmath>
+#include <limits>
+#include <string>
+#include <vector>
+#include <sstream>
+#include <iostream>
+#include <algorithm>
+
+//! two-sided 97.5% quantile of Student's t distribution with df degrees
+//! of freedom, approximated by 1.96 + 2.4/df above 30
+inline double t_quantile_975(size_t df)
+{
+    static const double table[30] = {
+        12.706, 4.303, 3.182, 2.776, 2.571, 2.447, 2.365, 2.306, 2.262, 2.228,
+        2.201, 2.179, 2.160, 2.145, 2.131, 2.120, 2.110, 2.101, 2.093, 2.086,
+        2.080, 2.074, 2.069, 2.064, 2.060, 2.056, 2.052, 2.048, 2.045, 2.042
+    };
+    if (df == 0)
+        return std::numeric_limits<double>::infinity();
+    if (df <= 30)
+        return table[df - 1];
+    return 1.96 + 2.4 / df;
+}
+
+//! Summary of the values of one field over all trials
+struct SampleStats
+{
+    double mean, median, stddev, ci95, min;
+
+    SampleStats(std::vector<double> v)
+        : mean(0), median(0), stddev(0), ci95(0), min(0)
+    {
+        if (v.empty()) return;
+        std::sort(v.begin(), v.end());
+        size_t n = v.size();
+
+        for (size_t i = 0; i < n; ++i)
+            mean += v[i];
+        mean /= n;
+
+        median = (n % 2) ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+        min = v[0];
+
+        if (n < 2) return;
+        double sq = 0;
+        for (size_t i = 0; i < n; ++i)
+            sq += (v[i] - mean) * (v[i] - mean);
+        stddev = std::sqrt(sq / (n - 1));
+        // half-width of the 95% confidence interval of the mean
+        ci95 = t_quantile_975(n - 1) * stddev / std::sqrt((double) n);
+    }
+};
+
+//! print " <prefix>p50= <prefix>p99= <prefix>p999= <prefix>max=" of
+//! a list of values, all 0 if it is empty
+template <typename T>
+void print_percentiles(std::ostream& os, const std::string& prefix, std::vector<T> v)
+{
+    std::sort(v.begin(), v.end());
+    const double q[3] = { 0.5, 0.99, 0.999 };
+    const char* name[3] = { "p50", "p99", "p999" };
+    for (int i = 0; i < 3; ++i)
+    {
+        os << " " << prefix << name[i] << "="
+           << (v.empty() ? T() : v[std::min(v.size() - 1, (size_t) (q[i] * v.size()))]);
+    }
+    os << " " << prefix << "max=" << (v.empty() ? T() : v.back());
+}
+
+//! Collects the " key=value" lines of repeated trials. Parameter fields and
+//! fields that are not numeric are printed as in the first trial, numeric
+//! fields as " key=<mean> key_median= key_stddev= key_ci95= key_min=".
+class TrialStats
+{
+protected:
+    struct Field
+    {
+        std::string key;
+        bool numeric;
+        std::string first;
+        std::vector<double> values;
+    };
+
+    std::vector<std::string> m_params;
+    std::vector<Field> m_fields;
+    size_t m_trials;
+
+    Field* find(const std::string& key)
+    {
+        for (size_t i = 0; i < m_fields.size(); ++i)
+        {
+            if (m_fields[i].key == key) return &m_fields[i];
+        }
+        return NULL;
+    }
+
+public:
+    //! params: comma separated keys that describe the configuration
+    TrialStats(const std::string& params)
+        : m_trials(0)
+    {
+        std::istringstream is(params);
+        std::string key;
+        while (std::getline(is, key, ','))
+            m_params.push_back(key);
+    }
+
+    //! add the output line of one trial
+    void add(const std::string& line)
+    {
+        std::istringstream is(line);
+        std::string token;
+        while (is >> token)
+        {
+            size_t eq = token.find('=');
+            if (eq == std::string::npos) continue;
+            std::string key = token.substr(0, eq), value = token.substr(eq + 1);
+
+            Field* f = find(key);
+            if (f == NULL)
+            {
+                Field nf;
+                nf.key = key;
+                nf.first = value;
+                nf.numeric = std::find(m_params.begin(), m_params.end(), key) == m_params.end();
+                m_fields.push_back(nf);
+                f = &m_fields.back();
+            }
+
+            char* end;
+            double v = strtod(value.c_str(), &end);
+            if (value.empty() || *end != 0)
+                f->numeric = false;
+            else if (f->numeric)
+                f->values.push_back(v);
+        }
+        m_trials++;
+    }
+
+    size_t trials() const
+    {
+        return m_trials;
+    }
+
+    //! half-width of the 95% confidence interval of a field relative to its
+    //! mean, infinity for fewer than two trials
+    double relative_ci95(const std::string& key) const
+    {
+        for (size_t i = 0; i < m_fields.size(); ++i)
+        {
+            if (m_fields[i].key != key || !m_fields[i].numeric) continue;
+            if (m_fields[i].values.size() < 2) break;
+            SampleStats s(m_fields[i].values);
+            return s.mean != 0 ? s.ci95 / std::fabs(s.mean) : 0;
+        }
+        return std::numeric_limits<double>::infinity();
+    }
+
+    //! print all fields and the number of trials as one line
+    void print(std::ostream& os) const
+    {
+        for (size_t i = 0; i < m_fields.size(); ++i)
+        {
+            const Field& f = m_fields[i];
+            if (!f.numeric)
+            {
+                os << " " << f.key << "=" << f.first;
+                continue;
+            }
+            SampleStats s(f.values);
+            os << " " << f.key << "=" << s.mean
+               << " " << f.key << "_median=" << s.median
+               << " " << f.key << "_stddev=" << s.stddev
+               << " " << f.key << "_ci95=" << s.ci95
+               << " " << f.key << "_min=" << s.min;
+        }
+        os << " reps=" << m_trials;
+    }
+};
+
+#endif // TOOLS_STATS_H